@@ -1,5 +1,8 @@
 
+#include <cstring>
+
 #include "Tools/Assert.h"
+#include "Tools/File.h"
 #include "Engine.h"
 #include "Namespace.h"
 #include "Parser.h"
@@ -71,6 +74,7 @@ bool Engine::resolveScript(const String& key, Word*& word, Namespace*& result)
   for(Namespace* space = currentSpace->getParent(); space; space = space->getParent())
     if(space->resolveScript2(key, word, result))
       return true;
+  recordKey(key, 0);
   return false;
 }
 
@@ -79,6 +83,7 @@ bool Engine::resolveScript(const String& key, Namespace* excludeStatements, Word
   for(Namespace* space = currentSpace->getParent(); space; space = space->getParent())
     if(space->resolveScript2(key, excludeStatements, word, result))
       return true;
+  recordKey(key, 0);
   return false;
 }
 
@@ -98,6 +103,11 @@ void Engine::getKeys(List<String>& keys)
   currentSpace->getKeys(keys);
 }
 
+void Engine::getKeys(Array<String>& keys)
+{
+  currentSpace->getKeys(keys);
+}
+
 void Engine::appendKeys(String& output)
 {
   return currentSpace->appendKeys(output);
@@ -114,6 +124,17 @@ bool Engine::getKeys(const String& key, List<String>& keys, bool allowInheritanc
   return false;
 }
 
+bool Engine::getKeys(const String& key, Array<String>& keys, bool allowInheritance)
+{
+  if(enterKey(key, allowInheritance))
+  {
+    currentSpace->getKeys(keys);
+    leaveKey();
+    return true;
+  }
+  return false;
+}
+
 String Engine::getFirstKey()
 {
   return currentSpace->getFirstKey();
@@ -135,6 +156,11 @@ void Engine::getText(List<String>& text)
   currentSpace->getText(text);
 }
 
+void Engine::getText(Array<String>& text)
+{
+  currentSpace->getText(text);
+}
+
 bool Engine::getText(const String& key, List<String>& text, bool allowInheritance)
 {
   if(enterKey(key, allowInheritance))
@@ -146,11 +172,46 @@ bool Engine::getText(const String& key, List<String>& text, bool allowInheritanc
   return false;
 }
 
+bool Engine::getText(const String& key, Array<String>& text, bool allowInheritance)
+{
+  if(enterKey(key, allowInheritance))
+  {
+    currentSpace->getText(text);
+    leaveKey();
+    return true;
+  }
+  return false;
+}
+
 String Engine::getMareDir() const
 {
   return currentSpace->getMareDir();
 }
 
+const GitIndex* Engine::getGitIndex()
+{
+  if(!gitIndexLoaded)
+  {
+    gitIndexAvailable = gitIndex.load();
+    gitIndexLoaded = true;
+  }
+  return gitIndexAvailable ? &gitIndex : 0;
+}
+
+void Engine::addInputFile(const String& file)
+{
+  long long writeTime;
+  if(!File::getWriteTime(file, writeTime))
+    writeTime = -1;
+  inputFiles.append(file, writeTime);
+}
+
+void Engine::addInputEnvironmentVariable(const String& name, const String& value)
+{
+  if(!inputEnvironmentVariables.find(name))
+    inputEnvironmentVariables.append(name, value);
+}
+
 void Engine::addDefaultKey(const String& key)
 {
   currentSpace->addDefaultKey(key);
@@ -171,6 +232,32 @@ void Engine::addCommandLineKey(const String& key, const String& value)
   currentSpace->addDefaultKey(key, Word::commandLineFlag, value);
 }
 
+void Engine::addVariantKey(const String& key)
+{
+  if(!variantKeys.find(key))
+    variantKeys.append(key);
+}
+
+void Engine::addFunction(const String& name, Function function, void* userData)
+{
+  Map<String, NativeFunction>::Node* node = functions.find(name);
+  NativeFunction& nativeFunction = node ? node->data : functions.append(name);
+  nativeFunction.function = function;
+  nativeFunction.userData = userData;
+}
+
+bool Engine::hasFunction(const String& name) const
+{
+  return functions.find(name) != 0;
+}
+
+void Engine::callFunction(const String& name, const List<String>& args, String& output)
+{
+  const Map<String, NativeFunction>::Node* node = functions.find(name);
+  if(node)
+    node->data.function(node->data.userData, args, output);
+}
+
 void Engine::setKey(const Word& key)
 {
   currentSpace->setKeyRaw(key);
@@ -190,3 +277,179 @@ bool Engine::popKey()
   stashedKeys.removeLast();
   return true;
 }
+
+/**
+* Finds the end of an expression without evaluating it.
+* @param expression The expression (after "$(")
+* @return The closing ")" or 0 if the expression is not closed
+*/
+static const char* skipExpression(const char* expression)
+{
+  for(;;)
+    switch(*expression)
+    {
+    case '\0':
+      return 0;
+    case ')':
+      return expression;
+    case '$':
+      if(expression[1] == '(')
+      {
+        expression = skipExpression(expression + 2);
+        if(!expression)
+          return 0;
+      }
+      else if(expression[1] == '$')
+        ++expression;
+      // no break
+    default:
+      ++expression;
+      break;
+    }
+}
+
+bool Engine::lookupExpression(const char*& expression, String& output)
+{
+  Namespace* context = currentSpace->getParent();
+  for(Namespace* space = context; space; space = space->getParent())
+  {
+    if((space->flags & (Namespace::compiledFlag | Namespace::compilingFlag)) != Namespace::compiledFlag)
+      return false;
+    const Map<const char*, Memo>::Node* node = space->memos.find(expression);
+    if(!node)
+      continue;
+    const Memo& memo = node->data;
+    size_t length = memo.expression.getLength();
+    if(strncmp(expression, memo.expression.getData(), length) != 0 || expression[length] != ')')
+      return false;
+
+    // the result cannot be used if a key between the current key and the key of the result overrides a key used by the expression
+    for(Namespace* i = context; i != space; i = i->getParent())
+      for(const List<String>::Node* j = memo.keys.getFirst(); j; j = j->getNext())
+        if(i->definesKey(j->data))
+          return false;
+
+    output.append(memo.value);
+    expression += length + 1;
+    if(memo.isVariant)
+      variantKeyUsed = true;
+    if(!expressionKeys.isEmpty())
+      addExpressionKeys(expressionKeys.getLast()->data, memo.keys, space->depth, false);
+    return true;
+  }
+
+  // look for a result of another configuration that was evaluated in an equivalent key
+  if(!context || sharedMemos.isEmpty())
+    return false;
+  const char* end = skipExpression(expression);
+  if(!end)
+    return false;
+  size_t length = end - expression;
+  const Map<unsigned long long, Memo>::Node* node = sharedMemos.find(getMemoIdentity(context, expression, length));
+  if(!node)
+    return false;
+  const Memo& memo = node->data;
+  if(memo.identity != context->identity || memo.expression.getLength() != length || strncmp(expression, memo.expression.getData(), length) != 0)
+    return false;
+  output.append(memo.value);
+  expression += length + 1;
+  if(!expressionKeys.isEmpty())
+    addExpressionKeys(expressionKeys.getLast()->data, memo.keys, memo.depth, false);
+  return true;
+}
+
+unsigned long long Engine::getMemoIdentity(const Namespace* context, const char* expression, size_t length)
+{
+  return Namespace::mixIdentity(context->identity, expression, length);
+}
+
+void Engine::beginExpression()
+{
+  ExpressionKeys& record = expressionKeys.append();
+  record.variantKeyUsed = beginVariantCheck();
+}
+
+void Engine::endExpression(const char* expression, size_t length, const char* result, size_t resultLength)
+{
+  ExpressionKeys& record = expressionKeys.getLast()->data;
+  bool isVariant = endVariantCheck(record.variantKeyUsed);
+
+  Namespace* context = currentSpace->getParent();
+  if(length > 0 && !record.isVolatile && context)
+  {
+    // memoize the result in the deepest key that provided a key used by the expression
+    Namespace* space = context;
+    while(space->depth > record.depth && (space->flags & (Namespace::compiledFlag | Namespace::compilingFlag)) == Namespace::compiledFlag)
+      space = space->getParent();
+    if(space != context && (space->flags & (Namespace::compiledFlag | Namespace::compilingFlag)) == Namespace::compiledFlag)
+    {
+      Map<const char*, Memo>::Node* node = space->memos.find(expression);
+      Memo& memo = node ? node->data : space->memos.append(expression);
+      memo.expression = String(expression, length);
+      memo.value = String(result, resultLength);
+      memo.keys = record.keys;
+      memo.isVariant = isVariant;
+    }
+
+    // results that do not depend on the configuration can be used in an equivalent key of another configuration
+    if(!isVariant && !variantKeys.isEmpty())
+    {
+      while(space && (space->flags & (Namespace::compiledFlag | Namespace::compilingFlag)) == Namespace::compiledFlag)
+        space = space->getParent();
+      if(!space)
+      {
+        unsigned long long identity = getMemoIdentity(context, expression, length);
+        Map<unsigned long long, Memo>::Node* node = sharedMemos.find(identity);
+        Memo& memo = node ? node->data : sharedMemos.append(identity);
+        memo.expression = String(expression, length);
+        memo.value = String(result, resultLength);
+        memo.keys = record.keys;
+        memo.depth = record.depth;
+        memo.identity = context->identity;
+      }
+    }
+  }
+
+  // the keys used by the expression are used by the enclosing expression as well
+  if(expressionKeys.getSize() > 1)
+    addExpressionKeys(expressionKeys.getLast()->getPrevious()->data, record.keys, record.depth, record.isVolatile);
+  expressionKeys.removeLast();
+}
+
+void Engine::setExpressionVolatile()
+{
+  if(!expressionKeys.isEmpty())
+    expressionKeys.getLast()->data.isVolatile = true;
+}
+
+void Engine::recordKey(const String& key, const Namespace* space)
+{
+  if(!variantKeys.isEmpty() && variantKeys.find(key))
+    variantKeyUsed = true;
+  if(expressionKeys.isEmpty())
+    return;
+  ExpressionKeys& record = expressionKeys.getLast()->data;
+  for(const List<String>::Node* i = record.keys.getFirst(); i; i = i->getNext())
+    if(i->data == key)
+      goto found;
+  record.keys.append(key);
+found:
+  if(space && space->depth > record.depth)
+    record.depth = space->depth;
+}
+
+void Engine::addExpressionKeys(ExpressionKeys& record, const List<String>& keys, unsigned int depth, bool isVolatile)
+{
+  for(const List<String>::Node* i = keys.getFirst(); i; i = i->getNext())
+  {
+    for(const List<String>::Node* j = record.keys.getFirst(); j; j = j->getNext())
+      if(j->data == i->data)
+        goto next;
+    record.keys.append(i->data);
+  next: ;
+  }
+  if(depth > record.depth)
+    record.depth = depth;
+  if(isVolatile)
+    record.isVolatile = true;
+}
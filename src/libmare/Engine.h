@@ -4,7 +4,9 @@
 #include "Tools/String.h"
 #include "Tools/List.h"
 #include "Tools/Map.h"
+#include "Tools/Array.h"
 #include "Tools/Scope.h"
+#include "Tools/GitIndex.h"
 
 class Namespace;
 class Word;
@@ -16,7 +18,7 @@ public:
 
   typedef void (*ErrorHandler)(void* userData, const String& file, int line, const String& message);
 
-  Engine(ErrorHandler errorHandler, void* userData) : errorHandler(errorHandler), errorUserData(userData), rootStatement(0), currentSpace(0) {}
+  Engine(ErrorHandler errorHandler, void* userData) : errorHandler(errorHandler), errorUserData(userData), rootStatement(0), currentSpace(0), gitIndexLoaded(false), gitIndexAvailable(false), variantKeyUsed(false) {}
 
   bool load(const String& file);
   void error(const String& message);
@@ -33,27 +35,165 @@ public:
   bool leaveKey();
   
   void getKeys(List<String>& keys);
+  void getKeys(Array<String>& keys);
   bool getKeys(const String& key, List<String>& keys, bool allowInheritance = true);
+  bool getKeys(const String& key, Array<String>& keys, bool allowInheritance = true);
   String getFirstKey();
   String getFirstKey(const String& key, bool allowInheritance = true);
   void getText(List<String>& text);
+  void getText(Array<String>& text);
   bool getText(const String& key, List<String>& text, bool allowInheritance = true);
+  bool getText(const String& key, Array<String>& text, bool allowInheritance = true);
   String getMareDir() const;
 
+  /**
+  * Returns the index of the Git working tree that contains the current working directory. The index is loaded on first use.
+  * @return The index or \c 0 if no index could be loaded
+  */
+  const GitIndex* getGitIndex();
+
+  /**
+  * Records a file or directory that was read while loading the Marefile or evaluating keys (e.g. an included Marefile, a directory searched for files matching a wildcard pattern or a file used with "readfile")
+  * @param file The path to the file or directory
+  */
+  void addInputFile(const String& file);
+
+  /**
+  * Records an environment variable that was looked up while evaluating keys
+  * @param name The name of the variable
+  * @param value The variable in the form "<name>=<value>" or an empty string if the variable is not defined
+  */
+  void addInputEnvironmentVariable(const String& name, const String& value);
+
+  /** Returns the recorded files and directories with their last modification times (or -1 if they did not exist) */
+  inline const Map<String, long long>& getInputFiles() const {return inputFiles;}
+
+  /** Returns the recorded environment variables */
+  inline const Map<String, String>& getInputEnvironmentVariables() const {return inputEnvironmentVariables;}
+
   void addDefaultKey(const String& key);
   void addDefaultKey(const String& key, const String& value);
   void addDefaultKey(const String& key, const Map<String, String>& value);
   void addCommandLineKey(const String& key, const String& value);
+
+  /**
+  * Declares a key that has a different value in each configuration (e.g. "configuration" or "Debug").
+  * Results of expressions that do not use any of these keys are shared between configurations.
+  * All variant keys have to be declared before evaluating the first configuration.
+  * @param key The name of the key
+  */
+  void addVariantKey(const String& key);
   
   void pushAndLeaveKey(); // TODO: hide these functions
   bool popKey();
 
+  /**
+  * Looks up the result of an expression like "cppFlags" or "patsubst %,-I%,$(includePaths)" that was evaluated before for the current key or for another child key of one of its parents.
+  * The result is reused if none of the keys used by the expression is defined in a key between the current key and that parent.
+  * @param expression The expression (following "$("). It is advanced behind the closing bracket if a result was found.
+  * @param output A string to which the result is appended
+  * @return Whether a result was found
+  */
+  bool lookupExpression(const char*& expression, String& output);
+
+  /** Starts recording the keys used by an expression */
+  void beginExpression();
+
+  /**
+  * Stops recording the keys used by an expression and memoizes its result in the deepest parent key that provided one of the used keys
+  * @param expression The expression (following "$(")
+  * @param length The length of the expression (without the closing bracket) or \c 0 if the result should not be memoized
+  * @param result The result of the expression
+  * @param resultLength The length of the result
+  */
+  void endExpression(const char* expression, size_t length, const char* result, size_t resultLength);
+
+  /** Prevents the results of the expressions that are being evaluated from being memoized (e.g. because they read or write files) */
+  void setExpressionVolatile();
+
+  /**
+  * A native function that can be used in expressions ("$(name arg1,arg2)").
+  * The result should only depend on the arguments, since it might be memoized.
+  * @param userData The pointer that was passed to addFunction()
+  * @param args The evaluated arguments
+  * @param output The string to which the result is appended
+  */
+  typedef void (*Function)(void* userData, const List<String>& args, String& output);
+
+  /**
+  * Adds a native function. Built-in functions (e.g. "subst") cannot be replaced.
+  * @param name The name of the function
+  * @param function The function
+  * @param userData A pointer that is passed to the function
+  */
+  void addFunction(const String& name, Function function, void* userData = 0);
+
+  bool hasFunction(const String& name) const;
+  void callFunction(const String& name, const List<String>& args, String& output);
+
+  /** Discards the results of previous wildcard searches (e.g. because a file was written) */
+  inline void clearFoundFiles() {foundFiles.clear();}
+
 private:
   ErrorHandler errorHandler;
   void* errorUserData;
   Statement* rootStatement;
   Namespace* currentSpace;
   List<Namespace*> stashedKeys;
+  GitIndex gitIndex;
+  bool gitIndexLoaded;
+  bool gitIndexAvailable;
+  Map<String, long long> inputFiles;
+  Map<String, String> inputEnvironmentVariables;
+
+  /** The keys used by an expression that is being evaluated */
+  class ExpressionKeys
+  {
+  public:
+    List<String> keys; /**< The names of the keys */
+    unsigned int depth; /**< The depth of the deepest key in which a used key was found */
+    bool isVolatile;
+    bool variantKeyUsed; /**< Whether a variant key was used before the expression was evaluated */
+
+    ExpressionKeys() : depth(0), isVolatile(false), variantKeyUsed(false) {}
+  };
+
+  /** The memoized result of an expression */
+  class Memo
+  {
+  public:
+    String expression; /**< The expression (without "$(" and ")") */
+    String value; /**< The result of the expression */
+    List<String> keys; /**< The keys used by the expression */
+    bool isVariant; /**< Whether the expression used a variant key */
+    unsigned int depth; /**< The depth of the deepest key in which a used key was found */
+    unsigned long long identity; /**< The identity of the key in which the expression was evaluated */
+
+    Memo() : isVariant(false), depth(0), identity(0) {}
+  };
+
+  /** A function added with addFunction() */
+  class NativeFunction
+  {
+  public:
+    Function function;
+    void* userData;
+
+    NativeFunction() : function(0), userData(0) {}
+  };
+
+  Map<String, NativeFunction> functions;
+  List<ExpressionKeys> expressionKeys;
+  Map<String, void*> variantKeys;
+  bool variantKeyUsed; /**< Whether a variant key was used since the last call of beginVariantCheck() */
+  Map<unsigned long long, Memo> sharedMemos; /**< Results of expressions that do not use variant keys by the identity of the key in which they were evaluated */
+  Map<String, List<String> > foundFiles; /**< The results of wildcard searches */
+
+  void recordKey(const String& key, const Namespace* space);
+  inline bool beginVariantCheck() {bool result = variantKeyUsed; variantKeyUsed = false; return result;}
+  inline bool endVariantCheck(bool variantKeyUsedBefore) {bool result = variantKeyUsed; variantKeyUsed |= variantKeyUsedBefore; return result;}
+  static unsigned long long getMemoIdentity(const Namespace* context, const char* expression, size_t length);
+  static void addExpressionKeys(ExpressionKeys& record, const List<String>& keys, unsigned int depth, bool isVolatile);
 
   bool resolveScript(const String& key, Word*& word, Namespace*& result);
   bool resolveScript(const String& key, Namespace* excludeStatements, Word*& word, Namespace*& result);
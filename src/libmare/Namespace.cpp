@@ -1,10 +1,13 @@
 
 #include <cstring>
+#include <cctype>
 
 #include "Tools/Assert.h"
 #include "Tools/File.h"
 #include "Tools/Directory.h"
 #include "Tools/Word.h"
+#include "Tools/Scan.h"
+#include "Tools/Pattern.h"
 #include "Tools/Process.h"
 #include "Namespace.h"
 #include "Statement.h"
@@ -23,6 +26,9 @@ String Namespace::evaluateString(const String& string) const
   {
     static void handle(Engine& engine, const char*& input, String& output, const char* endchars, bool evaluate = true)
     {
+      char stopchars[8];
+      stopchars[0] = '$';
+      strcpy(stopchars + 1, endchars);
       while(*input && !strchr(endchars, *input))
       {
         if(*input == '$')
@@ -30,6 +36,12 @@ String Namespace::evaluateString(const String& string) const
           if(input[1] == '(')
           {
             input += 2;
+            if(evaluate && engine.lookupExpression(input, output))
+              continue;
+            const char* expression = input;
+            size_t outputStart = output.getLength();
+            if(evaluate)
+              engine.beginExpression();
             String varOrCommand;
             handle(engine, input, varOrCommand, " )", evaluate);
             if(*input == ' ')
@@ -54,7 +66,13 @@ String Namespace::evaluateString(const String& string) const
                 handleVariable(engine, varOrCommand, output);
             }
             if(*input == ')')
+            {
               ++input;
+              if(evaluate)
+                engine.endExpression(expression, input - 1 - expression, output.getData() + outputStart, output.getLength() - outputStart);
+            }
+            else if(evaluate)
+              engine.endExpression(expression, 0, 0, 0);
           }
           else if(input[1] == '$')
           {
@@ -68,284 +86,495 @@ String Namespace::evaluateString(const String& string) const
         }
 
         const char* str = input++;
-        while(*input && *input != '$' && !strchr(endchars, *input))
-          ++input;
+        input = Scan::find(input, stopchars);
         if(evaluate)
           output.append(str, input - str);
       }
     }
-    static void handleCommand(Engine& engine, const String& cmd, const char*& input, String& output)
+    enum Function
+    {
+      unknownFunction,
+      substFunction,
+      patsubstFunction,
+      findstringFunction,
+      filterFunction,
+      filterOutFunction,
+      firstwordFunction,
+      lastwordFunction,
+      dirFunction,
+      notdirFunction,
+      suffixFunction,
+      basenameFunction,
+      addsuffixFunction,
+      addprefixFunction,
+      abspathFunction,
+      ifFunction,
+      foreachFunction,
+      originFunction,
+      lowerFunction,
+      upperFunction,
+      readfileFunction,
+      writefileFunction,
+    };
+    static void beginWord(const WordView& word, bool first, String& output)
+    {
+      if(!first)
+        output.append(' ');
+      if(word.flags & Word::quotedFlag)
+        output.append('"');
+    }
+    static void endWord(const WordView& word, String& output)
+    {
+      if(word.flags & Word::quotedFlag)
+        output.append('"');
+    }
+    static int getFunction(const String& name)
     {
-      if(cmd == "subst")
+      // the names are kept in a hashed map, so finding a function does not depend on the number of functions
+      static Map<String, int> functions;
+      if(functions.isEmpty())
       {
-        String from, to, text;
-        handle(engine, input, from, ",)"); if(*input == ',') ++input;
-        handle(engine, input, to, ",)"); if(*input == ',') ++input;
-        handle(engine, input, text, ",)"); if(*input == ',') ++input;
-
-        List<Word> words;
-        Word::split(text, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data.subst(from, to);
-        Word::append(words, output);
+        static const char* names[] = {
+          "subst", "patsubst", "findstring", "filter", "filter-out", "firstword", "lastword",
+          "dir", "notdir", "suffix", "basename", "addsuffix", "addprefix", "abspath", "if",
+          "foreach", "origin", "lower", "upper", "readfile", "writefile"
+        };
+        for(int i = 0; i < (int)(sizeof(names) / sizeof(*names)); ++i)
+          functions.append(String(names[i], -1), unknownFunction + 1 + i);
       }
-      else if(cmd == "patsubst")
+      return functions.lookup(name);
+    }
+    static void handleCommand(Engine& engine, const String& cmd, const char*& input, String& output)
+    {
+      int function = getFunction(cmd);
+      switch(function)
       {
-        String pattern, replace, text;
-        handle(engine, input, pattern, ",)"); if(*input == ',') ++input;
-        handle(engine, input, replace, ",)"); if(*input == ',') ++input;
-        handle(engine, input, text, ",)"); if(*input == ',') ++input;
-
-        List<Word> words;
-        Word::split(text, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data.patsubst(pattern, replace);
-        Word::append(words, output);
-      }
+      case substFunction:
+        {
+          String from, to, text;
+          handle(engine, input, from, ",)"); if(*input == ',') ++input;
+          handle(engine, input, to, ",)"); if(*input == ',') ++input;
+          handle(engine, input, text, ",)"); if(*input == ',') ++input;
+
+          Array<WordView> words;
+          Word::split(text, words);
+          const char* f = from.getData();
+          size_t flen = from.getLength();
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            const char* str = i->data, * strEnd = str + i->length, * start = str;
+            while(str < strEnd)
+              if(*str == *f && (size_t)(strEnd - str) >= flen && memcmp(str, f, flen) == 0)
+              {
+                output.append(start, str - start);
+                output.append(to);
+                str += flen;
+                start = str;
+              }
+              else
+                ++str;
+            output.append(start, str - start);
+            endWord(*i, output);
+          }
+        }
+        break;
+      case patsubstFunction:
+        {
+          String pattern, replace, text;
+          handle(engine, input, pattern, ",)"); if(*input == ',') ++input;
+          handle(engine, input, replace, ",)"); if(*input == ',') ++input;
+          handle(engine, input, text, ",)"); if(*input == ',') ++input;
+
+          Array<WordView> words;
+          Word::split(text, words);
+          Pattern matcher(pattern);
+          Pattern::Replacement replacement(replace);
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            const char* stem;
+            size_t stemLength;
+            if(matcher.match(i->data, i->length, stem, stemLength))
+              replacement.appendTo(stem, stemLength, output);
+            else
+              output.append(i->data, i->length);
+            endWord(*i, output);
+          }
+        }
+        break;
       // TODO: strip
-      else if(cmd == "findstring")
-      {
-        String find, in;
-        handle(engine, input, find, ",)"); if(*input == ',') ++input;
-        handle(engine, input, in, ",)"); if(*input == ',') ++input;
+      case findstringFunction:
+        {
+          String find, in;
+          handle(engine, input, find, ",)"); if(*input == ',') ++input;
+          handle(engine, input, in, ",)"); if(*input == ',') ++input;
 
-        if(in.contains(find))
-          output.append(find);
-      }
-      else if(cmd == "filter" || cmd == "filter-out")
-      {
-        String pattern, text;
-        handle(engine, input, pattern, ",)"); if(*input == ',') ++input;
-        handle(engine, input, text, ",)"); if(*input == ',') ++input;
-
-        List<Word> patternwords, words;
-        Word::split(pattern, patternwords);
-        Word::split(text, words);
-        if(cmd == "filter")
-          for(List<Word>::Node* i = words.getFirst(), * next; i; i = next)
+          if(in.contains(find))
+            output.append(find);
+        }
+        break;
+      case filterFunction:
+      case filterOutFunction:
+        {
+          String pattern, text;
+          handle(engine, input, pattern, ",)"); if(*input == ',') ++input;
+          handle(engine, input, text, ",)"); if(*input == ',') ++input;
+
+          Array<WordView> patternwords, words;
+          Word::split(pattern, patternwords);
+          Word::split(text, words);
+
+          // literal patterns are looked up in a hashed map, the others are matched one by one
+          Map<String, bool> literals;
+          List<Pattern> patterns;
+          for(const WordView* j = patternwords.getFirst(), * end = patternwords.getEnd(); j < end; ++j)
           {
-            next = i->getNext();
-            for(List<Word>::Node* j = patternwords.getFirst(); j; j = j->getNext())
-              if(i->data.patmatch(j->data))
-                goto keepWord;
-            words.remove(i);
-          keepWord: ;
+            Pattern matcher(String(j->data, j->length));
+            if(matcher.isLiteral())
+            {
+              if(!literals.find(matcher.getPattern()))
+                literals.append(matcher.getPattern(), true);
+            }
+            else
+              patterns.append(matcher);
           }
-        else
-          for(List<Word>::Node* i = words.getFirst(), * next; i; i = next)
+          bool keep = function == filterFunction;
+          bool first = true;
+          String word;
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
           {
-            next = i->getNext();
-            for(List<Word>::Node* j = patternwords.getFirst(); j; j = j->getNext())
-              if(i->data.patmatch(j->data))
-              {
-                words.remove(i);
-                break;
-              }
+            bool match = false;
+            if(!literals.isEmpty())
+            {
+              word.clear();
+              word.append(i->data, i->length);
+              match = literals.find(word) != 0;
+            }
+            if(!match)
+              for(List<Pattern>::Node* j = patterns.getFirst(); j; j = j->getNext())
+                if(j->data.match(i->data, i->length))
+                {
+                  match = true;
+                  break;
+                }
+            if(match == keep)
+            {
+              if(!first)
+                output.append(' ');
+              i->appendTo(output);
+              first = false;
+            }
           }
-        Word::append(words, output);
-      }
+        }
+        break;
       // TODO: sort, word, wordlist, words
-      else if(cmd == "firstword")
-      {
-        String text;
-        handle(engine, input, text, ",)"); if(*input == ',') ++input;
+      case firstwordFunction:
+        {
+          String text;
+          handle(engine, input, text, ",)"); if(*input == ',') ++input;
 
-        List<Word> words;
-        Word::split(text, words);
-        if(!words.isEmpty())
-          words.getFirst()->data.appendTo(output);
-      }
-      else if(cmd == "lastword")
-      {
-        String text;
-        handle(engine, input, text, ",)"); if(*input == ',') ++input;
+          Array<WordView> words;
+          Word::split(text, words);
+          if(!words.isEmpty())
+            words.getFirst()->appendTo(output);
+        }
+        break;
+      case lastwordFunction:
+        {
+          String text;
+          handle(engine, input, text, ",)"); if(*input == ',') ++input;
 
-        List<Word> words;
-        Word::split(text, words);
-        if(!words.isEmpty())
-          words.getLast()->data.appendTo(output);
-      }
-      else if(cmd == "dir")
-      {
-        String files;
-        handle(engine, input, files, ",)"); if(*input == ',') ++input;
-
-        List<Word> words;
-        Word::split(files, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data = File::getDirname(i->data);
-        Word::append(words, output);
-      }
-      else if(cmd == "notdir")
-      {
-        String files;
-        handle(engine, input, files, ",)"); if(*input == ',') ++input;
+          Array<WordView> words;
+          Word::split(text, words);
+          if(!words.isEmpty())
+            words[words.getSize() - 1].appendTo(output);
+        }
+        break;
+      case dirFunction:
+        {
+          String files;
+          handle(engine, input, files, ",)"); if(*input == ',') ++input;
+
+          Array<WordView> words;
+          Word::split(files, words);
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            const char* pos = i->data + i->length - 1;
+            for(; pos >= i->data; --pos)
+              if(*pos == '\\' || *pos == '/')
+                break;
+            if(pos >= i->data)
+              output.append(i->data, pos - i->data);
+            else
+              output.append('.');
+            endWord(*i, output);
+          }
+        }
+        break;
+      case notdirFunction:
+        {
+          String files;
+          handle(engine, input, files, ",)"); if(*input == ',') ++input;
         
-        List<Word> words;
-        Word::split(files, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data = File::getBasename(i->data);
-        Word::append(words, output);
-      }
-      else if(cmd == "suffix")
-      {
-        String files;
-        handle(engine, input, files, ",)"); if(*input == ',') ++input;
+          Array<WordView> words;
+          Word::split(files, words);
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            const char* pos = i->data + i->length - 1;
+            for(; pos >= i->data; --pos)
+              if(*pos == '\\' || *pos == '/')
+                break;
+            ++pos;
+            output.append(pos, i->data + i->length - pos);
+            endWord(*i, output);
+          }
+        }
+        break;
+      case suffixFunction:
+        {
+          String files;
+          handle(engine, input, files, ",)"); if(*input == ',') ++input;
         
-        List<Word> words;
-        Word::split(files, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data = File::getExtension(i->data);
-        Word::append(words, output);
-      }
-      else if(cmd == "basename")
-      {
-        String files;
-        handle(engine, input, files, ",)"); if(*input == ',') ++input;
+          Array<WordView> words;
+          Word::split(files, words);
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            for(const char* pos = i->data + i->length - 1; pos >= i->data; --pos)
+              if(*pos == '.')
+              {
+                ++pos;
+                output.append(pos, i->data + i->length - pos);
+                break;
+              }
+              else if(*pos == '\\' || *pos == '/')
+                break;
+            endWord(*i, output);
+          }
+        }
+        break;
+      case basenameFunction:
+        {
+          String files;
+          handle(engine, input, files, ",)"); if(*input == ',') ++input;
         
-        List<Word> words;
-        Word::split(files, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data = File::getWithoutExtension(i->data);
-        Word::append(words, output);
-      }
-      else if(cmd == "addsuffix")
-      {
-        String suffix, files;
-        handle(engine, input, suffix, ",)"); if(*input == ',') ++input;
-        handle(engine, input, files, ",)"); if(*input == ',') ++input;
+          Array<WordView> words;
+          Word::split(files, words);
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            size_t length = i->length;
+            for(const char* pos = i->data + i->length - 1; pos >= i->data; --pos)
+              if(*pos == '.')
+              {
+                length = pos - i->data;
+                break;
+              }
+              else if(*pos == '\\' || *pos == '/')
+                break;
+            output.append(i->data, length);
+            endWord(*i, output);
+          }
+        }
+        break;
+      case addsuffixFunction:
+        {
+          String suffix, files;
+          handle(engine, input, suffix, ",)"); if(*input == ',') ++input;
+          handle(engine, input, files, ",)"); if(*input == ',') ++input;
         
-        List<Word> words;
-        Word::split(files, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          ((String&)i->data).append(suffix);
-        Word::append(words, output);
-      }
-      else if(cmd == "addprefix")
-      {
-        String prefix, files;
-        handle(engine, input, prefix, ",)"); if(*input == ',') ++input;
-        handle(engine, input, files, ",)"); if(*input == ',') ++input;
+          Array<WordView> words;
+          Word::split(files, words);
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            output.append(i->data, i->length);
+            output.append(suffix);
+            endWord(*i, output);
+          }
+        }
+        break;
+      case addprefixFunction:
+        {
+          String prefix, files;
+          handle(engine, input, prefix, ",)"); if(*input == ',') ++input;
+          handle(engine, input, files, ",)"); if(*input == ',') ++input;
         
-        List<Word> words;
-        Word::split(files, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data.prepend(prefix);
-        Word::append(words, output);
-      }
-      // TODO: wildcard, realpath, abspath
-      else if(cmd == "if")
-      {
-        String condition;
-        handle(engine, input, condition, ",)"); if(*input == ',') ++input;
-        if(!condition.isEmpty())
-        { // then
-          handle(engine, input, output, ",)"); if(*input == ',') ++input;
-          handle(engine, input, output, ",)", false); if(*input == ',') ++input;
+          Array<WordView> words;
+          Word::split(files, words);
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            output.append(prefix);
+            output.append(i->data, i->length);
+            endWord(*i, output);
+          }
         }
-        else
+        break;
+      case abspathFunction:
         {
-          handle(engine, input, output, ",)", false); if(*input == ',') ++input;
-          handle(engine, input, output, ",)"); if(*input == ',') ++input;
+          String files;
+          handle(engine, input, files, ",)"); if(*input == ',') ++input;
+
+          Array<WordView> words;
+          Word::split(files, words);
+          String currentDir;
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            String file(i->data, i->length);
+            if(!File::isPathAbsolute(file))
+            {
+              if(currentDir.isEmpty())
+                currentDir = Directory::getCurrent() + "/";
+              file.prepend(currentDir);
+            }
+            output.append(File::simplifyPath(file));
+            endWord(*i, output);
+          }
         }
-      }
+        break;
+      // TODO: wildcard, realpath
+      case ifFunction:
+        {
+          String condition;
+          handle(engine, input, condition, ",)"); if(*input == ',') ++input;
+          if(!condition.isEmpty())
+          { // then
+            handle(engine, input, output, ",)"); if(*input == ',') ++input;
+            handle(engine, input, output, ",)", false); if(*input == ',') ++input;
+          }
+          else
+          {
+            handle(engine, input, output, ",)", false); if(*input == ',') ++input;
+            handle(engine, input, output, ",)"); if(*input == ',') ++input;
+          }
+        }
+        break;
       // TODO: or, and
-      else if(cmd == "foreach")
-      {
-        String var, list;
-        handle(engine, input, var, ",)"); if(*input == ',') ++input;
-        handle(engine, input, list, ",)"); if(*input == ',') ++input;
-
-        List<Word> words;
-        Word::split(list, words);
-        const char* inputStart = input;
-        engine.pushAndLeaveKey();
-        engine.enterUnnamedKey();
-        engine.enterNewKey(var);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
+      case foreachFunction:
         {
-          engine.setKey(i->data);
+          String var, list;
+          handle(engine, input, var, ",)"); if(*input == ',') ++input;
+          handle(engine, input, list, ",)"); if(*input == ',') ++input;
+
+          Array<WordView> words;
+          Word::split(list, words);
+          const char* inputStart = input;
           engine.pushAndLeaveKey();
           engine.enterUnnamedKey();
-          input = inputStart;
-          i->data.clear();
-          handle(engine, input, i->data, ",)");
+          engine.enterNewKey(var);
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            engine.setKey(i->toWord());
+            engine.pushAndLeaveKey();
+            engine.enterUnnamedKey();
+            input = inputStart;
+            beginWord(*i, i == words.getFirst(), output);
+            handle(engine, input, output, ",)");
+            endWord(*i, output);
+            engine.leaveKey(); // unnamed
+            engine.popKey();
+          }
+          engine.leaveKey();
           engine.leaveKey(); // unnamed
           engine.popKey();
+          if(*input == ',') ++input;
         }
-        engine.leaveKey();
-        engine.leaveKey(); // unnamed
-        engine.popKey();
-        if(*input == ',') ++input;
-        Word::append(words, output);
-      }
-      else if(cmd == "origin")
-      {
-        String var;
-        handle(engine, input, var, ",)"); if(*input == ',') ++input;
+        break;
+      case originFunction:
+        {
+          String var;
+          handle(engine, input, var, ",)"); if(*input == ',') ++input;
 
-        engine.pushAndLeaveKey();
-        output.append(engine.getKeyOrigin(var));
-        engine.popKey();
-      }
+          engine.pushAndLeaveKey();
+          output.append(engine.getKeyOrigin(var));
+          engine.popKey();
+        }
+        break;
       // TODO: call, value, eval, falvor, error, warning, info?
-      else if(cmd == "lower")
-      {
-        String text;
-        handle(engine, input, text, ",)"); if(*input == ',') ++input;
-        
-        List<Word> words;
-        Word::split(text, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data.lowercase();
-        Word::append(words, output);
-      }
-      else if(cmd == "upper")
-      {
-        String text;
-        handle(engine, input, text, ",)"); if(*input == ',') ++input;
+      case lowerFunction:
+      case upperFunction:
+        {
+          String text;
+          handle(engine, input, text, ",)"); if(*input == ',') ++input;
         
-        List<Word> words;
-        Word::split(text, words);
-        for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-          i->data.uppercase();
-        Word::append(words, output);
-      }
-      else if(cmd == "readfile")
-      {
-        String filepath;
-        handle(engine, input, filepath, ",)"); if(*input == ',') ++input;
-
-        File file;
-        if(file.open(filepath))
+          Array<WordView> words;
+          Word::split(text, words);
+          output.setCapacity(output.getLength() + text.getLength());
+          for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+          {
+            beginWord(*i, i == words.getFirst(), output);
+            if(function == lowerFunction)
+              for(const char* str = i->data, * strEnd = str + i->length; str < strEnd; ++str)
+                output.append((char)tolower(*(const unsigned char*)str));
+            else
+              for(const char* str = i->data, * strEnd = str + i->length; str < strEnd; ++str)
+                output.append((char)toupper(*(const unsigned char*)str));
+            endWord(*i, output);
+          }
+        }
+        break;
+      case readfileFunction:
         {
-          char buffer[2048];
-          size_t i;
-          while((i = file.read(buffer, sizeof(buffer))) > 0)
-            output.append(buffer, i);
+          String filepath;
+          handle(engine, input, filepath, ",)"); if(*input == ',') ++input;
+
+          engine.setExpressionVolatile();
+          engine.addInputFile(filepath);
+          File file;
+          if(file.open(filepath))
+          {
+            char buffer[2048];
+            size_t i;
+            while((i = file.read(buffer, sizeof(buffer))) > 0)
+              output.append(buffer, i);
+          }
         }
-      }
-      else if(cmd == "writefile")
-      {
-        String filepath;
-        String contents;
-        handle(engine, input, filepath, ",)"); if(*input == ',') ++input;
-        handle(engine, input, contents, ",)"); if(*input == ',') ++input;
+        break;
+      case writefileFunction:
+        {
+          String filepath;
+          String contents;
+          handle(engine, input, filepath, ",)"); if(*input == ',') ++input;
+          handle(engine, input, contents, ",)"); if(*input == ',') ++input;
 
-        Directory::create(File::getDirname(filepath));
+          engine.setExpressionVolatile();
+          engine.clearFoundFiles();
+          Directory::create(File::getDirname(filepath));
 
-        File file;
-        if(file.open(filepath, File::writeFlag) && file.write(contents))
-        {
-          // everything went well
-        } 
-        else
+          File file;
+          if(file.open(filepath, File::writeFlag) && file.write(contents))
+          {
+            // everything went well
+          } 
+          else
+          {
+            // something went wrong.
+            // but apparently you are not supposed to report errors here.
+            // so I don't care. sorry.
+          }
+          engine.addInputFile(filepath);
+          output.append(filepath);
+        }
+        break;
+      default:
+        if(engine.hasFunction(cmd))
         {
-          // something went wrong.
-          // but apparently you are not supposed to report errors here.
-          // so I don't care. sorry.
+          List<String> args;
+          for(;;)
+          {
+            handle(engine, input, args.append(), ",)");
+            if(*input != ',')
+              break;
+            ++input;
+          }
+          engine.callFunction(cmd, args, output);
         }
-        output.append(filepath);
+        break;
       }
     }
     static void handleVariable(Engine& engine, const String& variable, String& output)
@@ -362,6 +591,7 @@ String Namespace::evaluateString(const String& string) const
         const Map<String, String>::Node* envNode = envs.find(variable);
         if(envNode)
           output.append(envNode->data.getData() + envNode->key.getLength() + 1, envNode->data.getLength() - (envNode->key.getLength() + 1));
+        engine.addInputEnvironmentVariable(variable, envNode ? envNode->data : String());
       }
       engine.popKey();
     }
@@ -379,10 +609,16 @@ Namespace* Namespace::enterKey(const String& name, bool allowInheritance)
 
   Word key(name, 0);
   Map<Word, Namespace*>::Node* j = variables.find(key);
+  if(j || !allowInheritance)
+    engine->recordKey(name, this);
   if(j)
   {
     if(!j->data)
-      return (j->data = new Namespace(*this, this, engine, 0, 0, 0));
+    {
+      j->data = new Namespace(*this, this, engine, 0, 0, 0);
+      j->data->identity = mixIdentity(j->data->identity, name);
+      return j->data;
+    }
     if(allowInheritance || !(j->data->flags & inheritedFlag))
     {
       Namespace* lastSpace = j->data;
@@ -402,6 +638,9 @@ Namespace* Namespace::enterKey(const String& name, bool allowInheritance)
         if(engine->resolveScript(name, j->data, word, space))
         {
           Namespace* newSpace = space ? new Namespace(*this, this, engine, space->statement, space->next, inheritedFlag) : new Namespace(*this, this, engine, 0, 0, inheritedFlag);
+          newSpace->identity = mixIdentity(newSpace->identity, name);
+          if(space)
+            newSpace->identity = mixIdentity(newSpace->identity, &space->identity, sizeof(space->identity));
           lastSpace->next = lastSpace;
           return newSpace;
         }
@@ -417,6 +656,9 @@ Namespace* Namespace::enterKey(const String& name, bool allowInheritance)
     if(engine->resolveScript(name, word, space))
     {
       Namespace* newSpace = space ? new Namespace(*this, this, engine, space->statement, space->next, inheritedFlag) : new Namespace(*this, this, engine, 0, 0, inheritedFlag);
+      newSpace->identity = mixIdentity(newSpace->identity, name);
+      if(space)
+        newSpace->identity = mixIdentity(newSpace->identity, &space->identity, sizeof(space->identity));
       variables.append(*word, newSpace);
       return newSpace;
     }
@@ -436,6 +678,7 @@ Namespace* Namespace::enterNewKey(const String& name)
 
   Word key(name, 0);
   Namespace* space = new Namespace(*this, this, engine, 0, 0, 0);
+  space->identity = mixIdentity(space->identity, name);
   variables.append(key, space);
   return space;
 }
@@ -466,6 +709,7 @@ bool Namespace::resolveScript2(const String& name, Word*& word, Namespace*& resu
   Map<Word, Namespace*>::Node* node = variables.find(key);
   if(node)
   {
+    engine->recordKey(name, this);
     result = node->data;
     word = &node->key;
     if(!result)
@@ -491,6 +735,7 @@ bool Namespace::resolveScript2(const String& name, Namespace* excludeStatements,
   Map<Word, Namespace*>::Node* node = variables.find(key);
   if(node)
   {
+    engine->recordKey(name, this);
     result = node->data;
     word = &node->key;
     if(!result)
@@ -521,28 +766,28 @@ void Namespace::addKey(const String& key, unsigned int wordFlags, Statement* val
   // textMode?
   if(flags & textModeFlag)
   {
-    List<Word> words;
+    Array<WordView> words;
     Word::splitLines(evaluatedKey, words);
-    for(const List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-      addKeyRaw(i->data, 0, operation);
+    for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+      addKeyRaw(i->toWord(), 0, operation);
     return;
   }
 
   // split words
-  List<Word> words;
+  Array<WordView> words;
   Word::split(evaluatedKey, words);
 
   // add each word
-  for(List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
+  for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
   {
-    Word& word = i->data;
+    Word word = i->toWord();
     word.flags |= wordFlags;
 
     // expand wildcards
     if(word.flags == 0 && strpbrk(word.getData(), "*?")) 
     {
       List<String> files;
-      Directory::findFiles(word, files);
+      findFiles(word, files);
       for(const List<String>::Node* i = files.getFirst(); i; i = i->getNext())
         addKeyRaw(Word(i->data, 0), value, operation);
     }
@@ -559,27 +804,27 @@ void Namespace::removeKey(const String& key)
   // textMode?
   if(flags & textModeFlag)
   {
-    List<Word> words;
+    Array<WordView> words;
     Word::splitLines(evaluatedKey, words);
-    for(const List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
-      removeKeyRaw(i->data);
+    for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+      removeKeyRaw(String(i->data, i->length));
     return;
   }
 
   // split words
-  List<Word> words;
+  Array<WordView> words;
   Word::split(evaluatedKey, words);
 
   // add each word
-  for(const List<Word>::Node* i = words.getFirst(); i; i = i->getNext())
+  for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
   {
-    const Word& word = i->data;
+    const Word word = i->toWord();
 
     // expand wildcards
     if(!(word.flags & Word::quotedFlag) && strpbrk(word.getData(), "*?")) 
     {
       List<String> files;
-      Directory::findFiles(word, files);
+      findFiles(word, files);
       for(const List<String>::Node* i = files.getFirst(); i; i = i->getNext())
         removeKeyRaw(i->data);
     }
@@ -588,6 +833,34 @@ void Namespace::removeKey(const String& key)
   }
 }
 
+void Namespace::findFiles(const String& pattern, List<String>& files) const
+{
+  String globSource = evaluateString("$(globSource)");
+
+  // each pattern is searched only once (for all configurations)
+  String search = pattern;
+  search.append('\n');
+  search.append(globSource);
+  const Map<String, List<String> >::Node* node = engine->foundFiles.find(search);
+  if(node)
+  {
+    for(const List<String>::Node* i = node->data.getFirst(); i; i = i->getNext())
+      files.append(i->data);
+    return;
+  }
+
+  const GitIndex* gitIndex = globSource == "git" ? engine->getGitIndex() : 0;
+  List<String> dirs;
+  List<String>& foundFiles = engine->foundFiles.append(search);
+  Directory::findFiles(pattern, foundFiles, gitIndex, &dirs);
+  if(gitIndex)
+    engine->addInputFile(gitIndex->getPath());
+  for(const List<String>::Node* i = dirs.getFirst(); i; i = i->getNext())
+    engine->addInputFile(i->data);
+  for(const List<String>::Node* i = foundFiles.getFirst(); i; i = i->getNext())
+    files.append(i->data);
+}
+
 void Namespace::addKeyRaw(const Word& key, Statement* value, Token::Id operation)
 {
   ASSERT(!(flags & compiledFlag));
@@ -609,8 +882,10 @@ void Namespace::addKeyRaw(const Word& key, Statement* value, Token::Id operation
     {
       BinaryStatement* binaryStatement = new BinaryStatement(*this);
       binaryStatement->operation = operation == Token::plusAssignment ? Token::plus : Token::minus;
+      binaryStatement->identity = mixIdentity(mixIdentity(value->identity, &binaryStatement->operation, sizeof(binaryStatement->operation)), key);
       ReferenceStatement* referenceStatement = new ReferenceStatement(*this);
       referenceStatement->variable = key;
+      referenceStatement->identity = mixIdentity(0, key);
       binaryStatement->leftOperand = referenceStatement;
       binaryStatement->rightOperand = value;
       value = binaryStatement;
@@ -619,10 +894,18 @@ void Namespace::addKeyRaw(const Word& key, Statement* value, Token::Id operation
   case Token::assignment:
     {
       Map<Word, Namespace*>::Node* node = variables.find(key);
+      Namespace* space = 0;
+      if(value)
+      {
+        space = node ? new Namespace(node->data ? node->data->scope : *this, this, engine, value, node->data, 0) : new Namespace(value->scope, this, engine, value, 0, 0);
+        space->identity = mixIdentity(space->identity, key);
+        if(space->next)
+          space->identity = mixIdentity(space->identity, &space->next->identity, sizeof(space->next->identity));
+      }
       if(node)
-        node->data = value ? new Namespace(node->data ? node->data->scope : *this, this, engine, value, node->data, 0) : 0;
+        node->data = space;
       else
-        variables.append(key, value ? new Namespace(value->scope, this, engine, value, 0, 0) : 0);
+        variables.append(key, space);
     }
     break;
   default:
@@ -651,12 +934,29 @@ void Namespace::removeAllKeys()
     if(i->data)
       delete i->data;
   variables.clear();
+  memos.clear();
+  text.clear();
+  flags &= ~textCompiledFlag;
+}
+
+bool Namespace::definesKey(const String& key)
+{
+  Map<Word, Namespace*>::Node* node = variables.find(Word(key, 0));
+  return node && !(node->data && (node->data->flags & inheritedFlag));
 }
 
 void Namespace::setKeyRaw(const Word& key)
 {
   removeAllKeys();
   variables.append(key, 0);
+
+  // the value of the key is part of the parent key as well
+  identity = mixIdentity(identity, key);
+  if(parent)
+  {
+    parent->identity = mixIdentity(parent->identity, key);
+    parent->memos.clear();
+  }
 }
 
 void Namespace::removeKeysRaw(Namespace& space)
@@ -721,6 +1021,7 @@ bool Namespace::versionCompareKeys(Namespace& space, int& result)
 void Namespace::addDefaultStatement(Statement* statement)
 {
   ASSERT(!(flags & compiledFlag));
+  identity = mixIdentity(identity, statement);
   if(!defaultStatement)
     defaultStatement = statement;
   else
@@ -742,6 +1043,7 @@ void Namespace::addDefaultKey(const String& key)
 {
   StringStatement* stringStatement = new StringStatement(*this);
   stringStatement->value = key;
+  stringStatement->identity = mixIdentity(0, key);
   addDefaultStatement(stringStatement);
 }
 
@@ -749,29 +1051,36 @@ void Namespace::addDefaultKey(const String& key, unsigned int flags, const Strin
 {
   StringStatement* stringStatement = new StringStatement(*this);
   stringStatement->value = value;
+  stringStatement->identity = mixIdentity(0, value);
   AssignStatement* assignStatement = new AssignStatement(*this);
   assignStatement->variable = key;
   assignStatement->flags = flags;
   assignStatement->value = stringStatement;
+  assignStatement->identity = getDefaultKeyIdentity(key, flags, stringStatement);
   addDefaultStatement(assignStatement);
 }
 
 void Namespace::addDefaultKey(const String& key, unsigned int flags, const Map<String, String>& value)
 {
   BlockStatement* blockStatement = new BlockStatement(*this);
+  blockStatement->identity = 0;
   for(const Map<String, String>::Node* i = value.getFirst(); i; i = i->getNext())
   {
     StringStatement* stringStatement = new StringStatement(*this);
     stringStatement->value = i->data;
+    stringStatement->identity = mixIdentity(0, i->data);
     AssignStatement* assignStatement = new AssignStatement(*this);
     assignStatement->variable = i->key;
     assignStatement->value = stringStatement;
+    assignStatement->identity = mixIdentity(mixIdentity(0, i->key), stringStatement);
     blockStatement->statements.append(assignStatement);
+    blockStatement->identity = mixIdentity(blockStatement->identity, assignStatement);
   }
   AssignStatement* assignStatement = new AssignStatement(*this);
   assignStatement->variable = key;
   assignStatement->flags = flags;
   assignStatement->value = blockStatement;
+  assignStatement->identity = getDefaultKeyIdentity(key, flags, blockStatement);
   addDefaultStatement(assignStatement);
 }
 
@@ -786,19 +1095,63 @@ void Namespace::getKeys(List<String>& keys)
   }
 }
 
-void Namespace::getText(List<String>& text)
+void Namespace::getKeys(Array<String>& keys)
 {
-  // recompile in textMode
-  ASSERT(!(flags & compilingFlag));
-  removeAllKeys();
-  flags &= ~compiledFlag;
-  flags |= textModeFlag;
   compile();
-  flags &= ~(compiledFlag | textModeFlag);
+  for(Map<Word, Namespace*>::Node* node = variables.getFirst(); node; node = node->getNext())
+  {
+    if(node->data && (node->data->flags & inheritedFlag))
+      break;
+    keys.append(node->key);
+  }
+}
+
+void Namespace::compileText()
+{
+  if(!(flags & textCompiledFlag))
+  {
+    // compile in textMode while keeping the keys of a compilation in key mode
+    ASSERT(!(flags & compilingFlag));
+    Map<Word, Namespace*> keys;
+    keys.swap(variables);
+    unsigned int keyFlags = flags & (compiledFlag | variantFlag);
+    flags &= ~(compiledFlag | variantFlag);
+    flags |= textModeFlag;
+    compile();
+    if(flags & variantFlag)
+      flags |= textVariantFlag;
+    for(Map<Word, Namespace*>::Node* i = variables.getFirst(); i; i = i->getNext())
+    {
+      text.append(i->key);
+      if(i->data)
+        delete i->data;
+    }
+    variables.clear();
+    variables.swap(keys);
+    flags &= ~(compiledFlag | variantFlag | textModeFlag);
+    flags |= keyFlags | textCompiledFlag;
+  }
+  else if(flags & textVariantFlag)
+    engine->variantKeyUsed = true;
+}
+
+void Namespace::getText(List<String>& text)
+{
+  compileText();
 
   // copy each text line
-  for(Map<Word, Namespace*>::Node* i = variables.getFirst(); i; i = i->getNext())
-    text.append(i->key);
+  for(const String* i = this->text.getFirst(), * end = this->text.getEnd(); i < end; ++i)
+    text.append(*i);
+}
+
+void Namespace::getText(Array<String>& text)
+{
+  compileText();
+
+  // copy each text line
+  text.setCapacity(text.getSize() + this->text.getSize());
+  for(const String* i = this->text.getFirst(), * end = this->text.getEnd(); i < end; ++i)
+    text.append(*i);
 }
 
 void Namespace::appendKeys(String& output)
@@ -834,20 +1187,54 @@ String Namespace::getMareDir() const
   return String(".");
 }
 
+unsigned long long Namespace::getDefaultKeyIdentity(const String& key, unsigned int flags, const Statement* value) const
+{
+  // variant keys do not contribute, since they are different in each configuration
+  unsigned long long result = mixIdentity(0, &flags, sizeof(flags));
+  if(!engine->variantKeys.find(key))
+    result = mixIdentity(mixIdentity(result, key), value);
+  return result;
+}
+
+unsigned long long Namespace::mixIdentity(unsigned long long identity, const void* data, size_t length)
+{
+  // FNV-1a
+  unsigned long long result = identity ^ 14695981039346656037ULL;
+  for(const unsigned char* i = (const unsigned char*)data, * end = i + length; i < end; ++i)
+  {
+    result ^= *i;
+    result *= 1099511628211ULL;
+  }
+  return result;
+}
+
+unsigned long long Namespace::mixIdentity(unsigned long long identity, const Statement* statement)
+{
+  unsigned long long statementIdentity = statement ? statement->identity : 0;
+  return mixIdentity(identity, &statementIdentity, sizeof(statementIdentity));
+}
+
 void Namespace::compile()
 {
   if(flags & compiledFlag)
+  {
+    if(flags & variantFlag)
+      engine->variantKeyUsed = true;
     return;
+  }
   if(flags & compilingFlag)
   {
     ASSERT(false);
     return;
   }
   flags |= compilingFlag;
+  bool variantKeyUsed = engine->beginVariantCheck();
   if(defaultStatement)
     defaultStatement->execute(*this);
   if(statement)
     statement->execute(*this);
+  if(engine->endVariantCheck(variantKeyUsed))
+    flags |= variantFlag;
   flags &= ~compilingFlag;
   flags |= compiledFlag;
 }
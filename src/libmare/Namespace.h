@@ -5,14 +5,14 @@
 #include "Tools/Scope.h"
 #include "Tools/Word.h"
 #include "Token.h"
+#include "Engine.h"
 
-class Engine;
 class Statement;
 
 class Namespace : public Scope, public Scope::Object
 {
 public:
-  Namespace(Scope& scope, Namespace* parent, Engine* engine, Statement* statement, Namespace* next, unsigned int flags) : Scope::Object(scope), parent(parent), defaultStatement(0), statement(statement), next(next), engine(engine), flags(flags) {}
+  Namespace(Scope& scope, Namespace* parent, Engine* engine, Statement* statement, Namespace* next, unsigned int flags) : Scope::Object(scope), parent(parent), depth(parent ? parent->depth + 1 : 0), identity(mixIdentity(parent ? parent->identity : 0, statement)), defaultStatement(0), statement(statement), next(next), engine(engine), flags(flags) {}
   
   inline Namespace* getParent() {return parent;}
   bool resolveScript2(const String& name, Word*& word, Namespace*& result);
@@ -22,7 +22,9 @@ public:
   Namespace* enterNewKey(const String& name);
   String getKeyOrigin(const String& key);
   void getKeys(List<String>& keys);
+  void getKeys(Array<String>& keys);
   void getText(List<String>& text);
+  void getText(Array<String>& text);
   void appendKeys(String& output);
   String getFirstKey();
   String getMareDir() const;
@@ -51,18 +53,32 @@ private:
     compilingFlag = (1 << 3),
     unnamedFlag = (1 << 4),
     textModeFlag = (1 << 5),
+    variantFlag = (1 << 6), /**< The keys depend on keys that differ between configurations (see Engine::addVariantKey) */
+    textCompiledFlag = (1 << 7), /**< \c text holds the result of a compilation in text mode */
+    textVariantFlag = (1 << 8), /**< Like \c variantFlag for \c text */
   };
 
   Namespace* parent;
+  unsigned int depth; /**< The number of parent keys */
+  unsigned long long identity; /**< A hash of the statements, names and default keys of this key and its parents. It does not change between configurations. */
   Statement* defaultStatement;
   Statement* statement;
   Namespace* next;
   Engine* engine;
   unsigned int flags; 
   Map<Word, Namespace*> variables;
+  Array<String> text; /**< The lines of text (see getText) */
+  Map<const char*, Engine::Memo> memos; /**< Results of expressions that do not depend on keys of child keys */
 
   void compile();
+  void compileText();
+  bool definesKey(const String& key);
+  unsigned long long getDefaultKeyIdentity(const String& key, unsigned int flags, const Statement* value) const;
+  static unsigned long long mixIdentity(unsigned long long identity, const void* data, size_t length);
+  static unsigned long long mixIdentity(unsigned long long identity, const String& data) {return mixIdentity(identity, data.getData(), data.getLength() + 1);}
+  static unsigned long long mixIdentity(unsigned long long identity, const Statement* statement);
   String evaluateString(const String& string) const;
+  void findFiles(const String& pattern, List<String>& files) const;
 
   friend class Engine;
   friend class ReferenceStatement; // temporary hack
@@ -22,6 +22,7 @@ Statement* Parser::parse(const String& file, Engine::ErrorHandler errorHandler,
       errorHandler(errorHandlerUserData, file, 0, Error::getString());
       throw false;
     }
+    engine.addInputFile(file);
     includeFile = new IncludeFile(engine);
     includeFile->fileDir = File::getDirname(file);
     nextChar(); // read first character
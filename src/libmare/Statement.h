@@ -11,7 +11,9 @@ class Namespace;
 class Statement : public Scope::Object
 {
 public:
-  Statement(Scope& scope) : Scope::Object(scope) {}
+  Statement(Scope& scope) : Scope::Object(scope), identity((size_t)this) {}
+
+  unsigned long long identity; /**< Identifies the statement across configurations. Statements that are created during the evaluation use a hash of their content. */
 
   virtual void execute(Namespace& space) = 0;
 };
@@ -1,19 +1,63 @@
 
 #pragma once
 
+#include <cstddef> // for ptrdiff_t and size_t on Linux
+
+/**
+* An array that keeps its elements in a contiguous block of memory that grows when elements are appended.
+* Removed elements are not destroyed until they are overwritten or the array is deleted.
+*/
 template <typename T> class Array
 {
 public:
   Array() : data(0), size(0), capacity(0) {}
 
+  Array(const Array& other) : data(0), size(0), capacity(0)
+  {
+    *this = other;
+  }
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  Array(Array&& other) : data(0), size(0), capacity(0)
+  {
+    swap(other);
+  }
+#endif
+
   ~Array()
   {
     if(data)
       delete[] data;
   }
 
+  Array& operator=(const Array& other)
+  {
+    if(this != &other)
+    {
+      size = 0;
+      grow(other.size, 0);
+      for(T* pos = data, * end = data + other.size, * otherPos = other.data; pos < end;)
+        *(pos++) = *(otherPos++);
+      size = other.size;
+    }
+    return *this;
+  }
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  Array& operator=(Array&& other)
+  {
+    swap(other);
+    return *this;
+  }
+#endif
+
+  inline T& operator[](size_t index) {return data[index];}
+  inline const T& operator[](size_t index) const {return data[index];}
+
   T* getFirst() {return data;}
   const T* getFirst() const {return data;}
+  T* getEnd() {return data + size;}
+  const T* getEnd() const {return data + size;}
 
   const T* getData() const {return data;}
   T* getData(size_t size) const
@@ -32,13 +76,29 @@ public:
     return result;
   }
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  T& append(T&& elem)
+  {
+    size_t newSize = size + 1;
+    grow(newSize, size);
+    T& result = data[size];
+    result = static_cast<T&&>(elem);
+    size = newSize;
+    return result;
+  }
+#endif
+
   void remove(size_t index)
   {
     if(index < size)
     {
       --size;
       for(T* pos = data + index, * end = data + size; pos < end; ++pos)
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+        *pos = static_cast<T&&>(pos[1]);
+#else
         *pos = pos[1];
+#endif
     }
   }
 
@@ -63,6 +123,19 @@ public:
   inline void clear() {size = 0;}
   inline bool isEmpty() const {return size == 0;}
 
+  void swap(Array& other)
+  {
+    T* tmpData = data;
+    data = other.data;
+    other.data = tmpData;
+    size_t tmp = size;
+    size = other.size;
+    other.size = tmp;
+    tmp = capacity;
+    capacity = other.capacity;
+    other.capacity = tmp;
+  }
+
 private:
   T* data;
   size_t size;
@@ -76,7 +149,11 @@ private:
       this->capacity = capacity + 16 + (capacity >> 1);
       data = new T[this->capacity];
       for(T* pos = data, * end = data + this->size, * oldPos = oldData; pos < end;)
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+        *(pos++) = static_cast<T&&>(*(oldPos++));
+#else
         *(pos++) = *(oldPos++);
+#endif
       if(oldData)
         delete[] oldData;
       this->size = size;
@@ -7,6 +7,7 @@
 #include <cstring>
 #ifdef _WIN32
 #include <windows.h>
+#include <cctype>
 #else
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -21,6 +22,7 @@
 #include "List.h"
 #include "Map.h"
 #include "File.h"
+#include "GitIndex.h"
 
 Directory::Directory()
 {
@@ -191,7 +193,43 @@ bool Directory::read(String& name, bool& isDir)
 #endif
 }
 
-void Directory::findFiles(const String& pattern, List<String>& files)
+bool Directory::match(const String& pattern, const String& name)
+{
+#ifdef _WIN32
+  // FindFirstFileEx supports the wildcards '*' and '?' and ignores the case
+  const char* pat = pattern.getData();
+  const char* str = name.getData();
+  const char* starPattern = 0;
+  const char* starName = 0;
+  while(*str)
+  {
+    if(*pat == '*')
+    {
+      starPattern = ++pat;
+      starName = str;
+    }
+    else if(*pat == '?' || tolower((unsigned char)*pat) == tolower((unsigned char)*str))
+    {
+      ++pat;
+      ++str;
+    }
+    else if(starPattern)
+    {
+      pat = starPattern;
+      str = ++starName;
+    }
+    else
+      return false;
+  }
+  while(*pat == '*')
+    ++pat;
+  return !*pat;
+#else
+  return fnmatch(pattern.getData(), name.getData(), 0) == 0;
+#endif
+}
+
+void Directory::findFiles(const String& pattern, List<String>& files, const GitIndex* index, List<String>* dirs)
 {
   // replace ** with * / ** and split in chunks
   List<String> chunks;
@@ -214,6 +252,8 @@ void Directory::findFiles(const String& pattern, List<String>& files)
   {
     List<String>* files;
     bool dirsOnly;
+    const GitIndex* index;
+    List<String>* dirs;
 
     void handlePath(const String& path, const String& pattern, const List<String>::Node* nextChunk)
     {
@@ -299,6 +339,32 @@ void Directory::findFiles(const String& pattern, List<String>& files)
 
     void handlePath2(const String& path, const String& pattern, const String& nextPattern, const List<String>::Node* nextNextChunk)
     {
+      String dirpath = path.isEmpty() ? String(".") : path;
+      if(dirs)
+        dirs->append(dirpath);
+
+      // list a directory from the index if Git recorded its untracked files in the untracked cache and the directory has not
+      // been modified since then (files created or deleted in the directory change its modification time), otherwise fall back
+      // to reading the directory from the file system
+      if(index)
+      {
+        const GitIndex::Entry* dirEntry = index->findDir(path);
+        long long writeTime;
+        if(dirEntry && dirEntry->untrackedTime != 0 && dirEntry->untrackedTime < index->getWriteTime() &&
+           File::getWriteTime(dirpath, writeTime) && writeTime == dirEntry->untrackedTime)
+        {
+          bool dirsOnly = !nextPattern.isEmpty() || this->dirsOnly;
+          for(const List<GitIndex::Entry>::Node* i = dirEntry->entries.getFirst(); i; i = i->getNext())
+          {
+            const GitIndex::Entry& entry = i->data;
+            if((!entry.isDir && dirsOnly) || !match(pattern, entry.name))
+              continue;
+            handleSubPath(path, entry.name, entry.isDir, nextPattern, nextNextChunk);
+          }
+          return;
+        }
+      }
+
       Directory dir; String name; bool isDir;
       if(dir.open(path, pattern, !nextPattern.isEmpty() || dirsOnly))
         while(dir.read(name, isDir))
@@ -336,6 +402,8 @@ void Directory::findFiles(const String& pattern, List<String>& files)
     char lastChar = pattern.getData()[pattern.getLength() - 1];
     ff.dirsOnly = lastChar == '/' || lastChar == '\\';
     ff.files = &files;
+    ff.index = index;
+    ff.dirs = dirs;
     ff.handlePath(String(), chunks.getFirst()->data, chunks.getFirst()->getNext());
   }
 }
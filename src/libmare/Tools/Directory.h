@@ -9,6 +9,8 @@
 #include "String.h"
 #include "List.h"
 
+class GitIndex;
+
 /** A Class for accessing directories */
 class Directory
 {
@@ -37,7 +39,23 @@ public:
   */
   bool read(String& path, bool& isDir);
 
-  static void findFiles(const String& pattern, List<String>& files);
+  /**
+  * Matches the name of a directory entry against a search pattern like "*.inf" the way open() and read() do
+  * @param pattern The search pattern
+  * @param name The name of the entry
+  * @return Whether the name matches the pattern
+  */
+  static bool match(const String& pattern, const String& name);
+
+  /**
+  * Searches files matching a wildcard pattern like "**.cpp"
+  * @param pattern The pattern
+  * @param files The list the paths of the found files are appended to
+  * @param index A Git index used to list the entries of tracked directories that have not changed since the index was
+  *              written instead of reading them from the file system
+  * @param dirs A list the paths of the searched directories are appended to
+  */
+  static void findFiles(const String& pattern, List<String>& files, const GitIndex* index = 0, List<String>* dirs = 0);
 
   static bool exists(const String& dir);
 
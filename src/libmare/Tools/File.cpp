@@ -8,7 +8,9 @@
 #include <cerrno>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <utime.h>
 #endif
 
 #include "Assert.h"
@@ -59,6 +61,103 @@ bool File::unlink(const String& file)
   return true;
 }
 
+bool File::rename(const String& from, const String& to)
+{
+#ifdef _WIN32
+  if(!MoveFileExA(from.getData(), to.getData(), MOVEFILE_REPLACE_EXISTING))
+    return false;
+#else
+  if(::rename(from.getData(), to.getData()) != 0)
+    return false;
+#endif
+  return true;
+}
+
+bool File::copy(const String& src, const String& dest)
+{
+#ifdef _WIN32
+  if(!CopyFileA(src.getData(), dest.getData(), FALSE))
+    return false;
+  return touch(dest); // CopyFile keeps the modification time of the source
+#else
+  struct stat buf, destBuf;
+  if(stat(src.getData(), &buf) != 0)
+    return false;
+  if(stat(dest.getData(), &destBuf) == 0 && destBuf.st_dev == buf.st_dev && destBuf.st_ino == buf.st_ino)
+  {
+    errno = EINVAL; // opening the destination would truncate the source (CopyFile fails in this case as well)
+    return false;
+  }
+  int srcFd = ::open(src.getData(), O_RDONLY);
+  if(srcFd == -1)
+    return false;
+  int destFd = ::open(dest.getData(), O_WRONLY | O_CREAT | O_TRUNC, buf.st_mode & 0777);
+  if(destFd == -1)
+  {
+    ::close(srcFd);
+    return false;
+  }
+  char buffer[0x10000];
+  bool result = true;
+  for(;;)
+  {
+    ssize_t i = ::read(srcFd, buffer, sizeof(buffer));
+    if(i <= 0)
+    {
+      result = i == 0;
+      break;
+    }
+    if(::write(destFd, buffer, i) != i)
+    {
+      result = false;
+      break;
+    }
+  }
+  ::close(srcFd);
+  if(::close(destFd) != 0)
+    result = false;
+  return result;
+#endif
+}
+
+bool File::touch(const String& file)
+{
+#ifdef _WIN32
+  HANDLE hFile = CreateFileA(file.getData(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(hFile == INVALID_HANDLE_VALUE)
+    return false;
+  FILETIME now;
+  GetSystemTimeAsFileTime(&now);
+  bool result = SetFileTime(hFile, NULL, &now, &now) != FALSE;
+  CloseHandle(hFile);
+  return result;
+#else
+  int fd = ::open(file.getData(), O_WRONLY | O_CREAT, 0666);
+  if(fd == -1)
+    return false;
+  ::close(fd);
+  return utime(file.getData(), 0) == 0;
+#endif
+}
+
+bool File::link(const String& target, const String& link)
+{
+#ifdef _WIN32
+  String src = target;
+  if(!isPathAbsolute(target))
+  {
+    src = getDirname(link);
+    src.append('/');
+    src.append(target);
+  }
+  return copy(src, link);
+#else
+  if(::unlink(link.getData()) != 0 && errno != ENOENT)
+    return false;
+  return symlink(target.getData(), link.getData()) == 0;
+#endif
+}
+
 bool File::open(const String& file, Flags flags)
 {
 #ifdef _WIN32
@@ -71,7 +170,7 @@ bool File::open(const String& file, Flags flags)
   if(flags & writeFlag)
   {
     desiredAccess |= GENERIC_WRITE;
-    creationDisposition |= CREATE_ALWAYS;
+    creationDisposition |= flags & appendFlag ? OPEN_ALWAYS : CREATE_ALWAYS;
   }
   if(flags & readFlag)
   {
@@ -121,12 +220,16 @@ bool File::open(const String& file, Flags flags)
 #else
   if(fp)
     return false;
-  const char* mode = (flags & (writeFlag | readFlag)) == (writeFlag | readFlag) ? "w+" : (flags & writeFlag ? "w" : "r");
+  const char* mode = (flags & (writeFlag | readFlag)) == (writeFlag | readFlag) ? (flags & appendFlag ? "a+" : "w+") : (flags & writeFlag ? (flags & appendFlag ? "a" : "w") : "r");
   fp = fopen(file.getData(), mode);
   if(!fp)
     return false;
 #endif
 
+#ifdef _WIN32
+  if(flags & appendFlag)
+    SetFilePointer((HANDLE)fp, 0, NULL, FILE_END);
+#endif
   return true;
 }
 
@@ -10,6 +10,7 @@ public:
   {
     readFlag = 0x0001,
     writeFlag = 0x0002,
+    appendFlag = 0x0004, /**< Keeps the content of an existing file and writes behind it (in combination with \c writeFlag) */
   };
 
   File();
@@ -34,6 +35,38 @@ public:
   static bool exists(const String& file);
   static bool unlink(const String& file);
 
+  /**
+  * Moves a file. An existing file at the destination is replaced.
+  * @param from The file to move
+  * @param to The new path of the file
+  * @return Whether the file was moved successfully
+  */
+  static bool rename(const String& from, const String& to);
+
+  /**
+  * Copies a file. The copy gets the current time as modification time.
+  * @param src The file to copy
+  * @param dest The path of the copy. An existing file is overwritten (unless it is the source file).
+  * @return Whether the file was copied successfully
+  */
+  static bool copy(const String& src, const String& dest);
+
+  /**
+  * Creates an empty file or sets the modification time of an existing file to the current time
+  * @param file The file
+  * @return Whether the file was created or updated successfully
+  */
+  static bool touch(const String& file);
+
+  /**
+  * Creates a symbolic link. An existing file at the path of the link is replaced. (On Windows, where creating symbolic links
+  * requires special privileges, the target is copied instead.)
+  * @param target The target of the link (relative to the directory of the link if it is not absolute)
+  * @param link The path of the link
+  * @return Whether the link was created successfully
+  */
+  static bool link(const String& target, const String& link);
+
 private:
   void* fp;
 };
@@ -0,0 +1,468 @@
+/**
+* @file GitIndex.cpp
+* Implementation of a class for reading the list of tracked files from the index of a Git working tree.
+* @author Colin Graf
+*/
+
+#include <cstring>
+
+#include "GitIndex.h"
+#include "Array.h"
+#include "File.h"
+#include "Directory.h"
+
+static bool readFile(const String& path, String& data)
+{
+  File file;
+  if(!file.open(path))
+    return false;
+  char buffer[65536];
+  size_t i;
+  while((i = file.read(buffer, sizeof(buffer))) > 0)
+    data.append(buffer, i);
+  return true;
+}
+
+static inline unsigned int readUInt32(const unsigned char* p)
+{
+  return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | (unsigned int)p[3];
+}
+
+static inline unsigned int readUInt16(const unsigned char* p)
+{
+  return ((unsigned int)p[0] << 8) | (unsigned int)p[1];
+}
+
+static inline unsigned long long readUInt64(const unsigned char* p)
+{
+  return ((unsigned long long)readUInt32(p) << 32) | (unsigned long long)readUInt32(p + 4);
+}
+
+/** Reads a variable width integer (as used for the prefix compression of paths and in the untracked cache) */
+static bool readVarint(const unsigned char*& pos, const unsigned char* end, size_t& value)
+{
+  if(pos >= end)
+    return false;
+  unsigned char c = *pos++;
+  value = c & 127;
+  while(c & 128)
+  {
+    if(pos >= end)
+      return false;
+    c = *pos++;
+    value = ((value + 1) << 7) | (c & 127);
+  }
+  return true;
+}
+
+/** Reads a NUL-terminated string */
+static bool readString(const unsigned char*& pos, const unsigned char* end, String& str)
+{
+  const unsigned char* strEnd = (const unsigned char*)memchr(pos, '\0', end - pos);
+  if(!strEnd)
+    return false;
+  str = String((const char*)pos, strEnd - pos);
+  pos = strEnd + 1;
+  return true;
+}
+
+/** Reads an EWAH compressed bitmap with up to \c size bits */
+static bool readBitmap(const unsigned char*& pos, const unsigned char* end, size_t size, Array<bool>& bits)
+{
+  if(end - pos < 8)
+    return false;
+  size_t bitCount = readUInt32(pos);
+  size_t wordCount = readUInt32(pos + 4);
+  pos += 8;
+  if(bitCount > size || (size_t)(end - pos) < 4 || wordCount > ((size_t)(end - pos) - 4) / 8)
+    return false;
+  bits.setSize(size);
+  for(bool* i = bits.getFirst(), * bitsEnd = bits.getEnd(); i < bitsEnd; ++i)
+    *i = false;
+  size_t bit = 0;
+  for(const unsigned char* word = pos, * wordEnd = pos + wordCount * 8; word < wordEnd && bit < bitCount;)
+  { // a marker word is followed by literal words and describes a run of words with all bits cleared or set before them
+    unsigned long long marker = readUInt64(word);
+    word += 8;
+    bool runBit = (marker & 1) != 0;
+    unsigned long long runBits = ((marker >> 1) & 0xffffffffULL) * 64;
+    for(; runBits > 0 && bit < bitCount; --runBits)
+      bits[bit++] = runBit;
+    for(size_t literalWords = (size_t)(marker >> 33); literalWords > 0 && word < wordEnd; --literalWords, word += 8)
+    {
+      unsigned long long literal = readUInt64(word);
+      for(int i = 0; i < 64 && bit < bitCount; ++i)
+        bits[bit++] = ((literal >> i) & 1) != 0;
+    }
+  }
+  pos += wordCount * 8 + 4;
+  return true;
+}
+
+/** A directory block of the untracked cache */
+class UntrackedDir
+{
+public:
+  String path; /**< The path of the directory relative to the working tree */
+  List<String> names; /**< The untracked files and directories (with a trailing slash) */
+};
+
+/** Reads a directory block of the untracked cache and the blocks of its subdirectories (in depth-first order) */
+static bool readUntrackedDir(const unsigned char*& pos, const unsigned char* end, const String& parentPath, List<UntrackedDir>& dirs)
+{
+  size_t untrackedCount, dirCount;
+  String name;
+  if(!readVarint(pos, end, untrackedCount) || !readVarint(pos, end, dirCount) || !readString(pos, end, name))
+    return false;
+  UntrackedDir& dir = dirs.append();
+  dir.path = parentPath;
+  if(!parentPath.isEmpty())
+    dir.path.append('/');
+  dir.path.append(name);
+  for(; untrackedCount > 0; --untrackedCount)
+    if(!readString(pos, end, dir.names.append()))
+      return false;
+  for(; dirCount > 0; --dirCount)
+    if(!readUntrackedDir(pos, end, dir.path, dirs))
+      return false;
+  return true;
+}
+
+/** Converts a time stamp of an index entry to the time format of File::getWriteTime */
+static inline long long readTime(const unsigned char* p)
+{
+#ifdef _WIN32
+  return (long long)readUInt32(p) * 10000000LL + (long long)(readUInt32(p + 4) / 100) + 116444736000000000LL;
+#else
+  return (long long)readUInt32(p) * 1000000000LL + (long long)readUInt32(p + 4);
+#endif
+}
+
+bool GitIndex::findGitDir(String& gitDir, String& prefix)
+{
+  String cwd = Directory::getCurrent();
+  const char* cwdData = cwd.getData();
+  for(ptrdiff_t end = cwd.getLength(); end > 0;)
+  {
+    String workTree = cwd.substr(0, end);
+    String dotGit = workTree;
+    dotGit.append("/.git");
+    if(Directory::exists(dotGit))
+      gitDir = dotGit;
+    else if(File::exists(dotGit))
+    { // a linked working tree or submodule with a "gitdir: <path>" file
+      String content;
+      if(!readFile(dotGit, content) || strncmp(content.getData(), "gitdir:", 7) != 0)
+        return false;
+      const char* start = content.getData() + 7;
+      while(*start == ' ')
+        ++start;
+      const char* stop = content.getData() + content.getLength();
+      while(stop > start && (stop[-1] == '\n' || stop[-1] == '\r' || stop[-1] == ' '))
+        --stop;
+      gitDir = String(start, stop - start);
+      if(!File::isPathAbsolute(gitDir))
+        gitDir.prepend(workTree + "/");
+    }
+
+    if(!gitDir.isEmpty())
+    {
+      prefix = static_cast<size_t>(end) < cwd.getLength() ? cwd.substr(end + 1) : String();
+      prefix.subst("\\", "/");
+      return true;
+    }
+
+    do
+      --end;
+    while(end > 0 && cwdData[end] != '/' && cwdData[end] != '\\');
+  }
+  return false;
+}
+
+bool GitIndex::load()
+{
+  String gitDir, prefix;
+  if(!findGitDir(gitDir, prefix))
+    return false;
+
+  String data;
+  String indexPath = gitDir + "/index";
+  if(!File::getWriteTime(indexPath, writeTime) || !readFile(indexPath, data))
+    return false;
+
+  // repositories using SHA-256 object names store longer hashes in each entry
+  size_t hashSize = 20;
+  {
+    String config;
+    size_t pos;
+    if(readFile(gitDir + "/config", config) && config.find(String("objectformat"), pos))
+    {
+      const char* str = config.getData() + pos + 12;
+      while(*str == ' ' || *str == '\t' || *str == '=')
+        ++str;
+      if(strncmp(str, "sha256", 6) == 0)
+        hashSize = 32;
+    }
+  }
+
+  // read header
+  const unsigned char* pos = (const unsigned char*)data.getData();
+  const unsigned char* end = pos + data.getLength();
+  if(data.getLength() < 12 || memcmp(pos, "DIRC", 4) != 0)
+    return false;
+  unsigned int version = readUInt32(pos + 4);
+  if(version < 2 || version > 4)
+    return false;
+  unsigned int entryCount = readUInt32(pos + 8);
+  pos += 12;
+
+  // read entries
+  String prefixDir = prefix;
+  if(!prefixDir.isEmpty())
+    prefixDir.append('/');
+  String path, lastPath;
+  for(unsigned int i = 0; i < entryCount; ++i)
+  {
+    const unsigned char* entryStart = pos;
+    size_t nameOffset = 40 + hashSize + 2;
+    if((size_t)(end - pos) < nameOffset + 1)
+      return false;
+    unsigned int mode = readUInt32(pos + 24);
+    unsigned int flags = readUInt16(pos + 40 + hashSize);
+    unsigned int extendedFlags = 0;
+    if(version >= 3 && (flags & 0x4000))
+    {
+      extendedFlags = readUInt16(pos + nameOffset);
+      nameOffset += 2;
+    }
+    pos += nameOffset;
+
+    if(version == 4)
+    { // the path is prefix compressed against the path of the previous entry
+      size_t strip;
+      if(!readVarint(pos, end, strip))
+        return false;
+      const unsigned char* nameEnd = (const unsigned char*)memchr(pos, '\0', end - pos);
+      if(!nameEnd || strip > path.getLength())
+        return false;
+      path.setLength(path.getLength() - strip);
+      path.append((const char*)pos, nameEnd - pos);
+      pos = nameEnd + 1;
+    }
+    else
+    {
+      const unsigned char* nameEnd = (const unsigned char*)memchr(pos, '\0', end - pos);
+      if(!nameEnd)
+        return false;
+      path = String((const char*)pos, nameEnd - pos);
+      pos = entryStart + ((nameOffset + (nameEnd - pos) + 8) & ~7);
+      if(pos > end)
+        return false;
+    }
+
+    // skip files which are not checked out and further stages of conflicting files
+    if(extendedFlags & 0x4000)
+      continue;
+    if(path == lastPath)
+      continue;
+    lastPath = path;
+
+    // ignore files outside of the current working directory
+    if(!prefixDir.isEmpty() && strncmp(path.getData(), prefixDir.getData(), prefixDir.getLength()) != 0)
+      continue;
+
+    // insert into the tree (the entries are sorted, so a directory is always the last entry of its parent)
+    Entry* dir = &root;
+    const char* str = path.getData() + prefixDir.getLength();
+    for(;;)
+    {
+      const char* sep = strchr(str, '/');
+      if(!sep || !sep[1])
+      {
+        String name(str, sep ? sep - str : -1);
+        Entry& entry = dir->entries.append();
+        entry.name = name;
+        if(sep || (mode & 0170000) == 0160000) // sparse directory or submodule
+          entry.isDir = true;
+        break;
+      }
+      String name(str, sep - str);
+      List<Entry>::Node* last = dir->entries.getLast();
+      if(!last || !last->data.isDir || last->data.name != name)
+      {
+        Entry& entry = dir->entries.append();
+        entry.name = name;
+        entry.isDir = true;
+        entry.tracked = true;
+        dir = &entry;
+      }
+      else
+        dir = &last->data;
+      str = sep + 1;
+    }
+  }
+
+  root.isDir = true;
+  root.tracked = true;
+
+  // read the extensions (the index file ends with a checksum)
+  if((size_t)(end - pos) < hashSize)
+    return false;
+  end -= hashSize;
+  while(end - pos >= 8)
+  {
+    size_t size = readUInt32(pos + 4);
+    if(size > (size_t)(end - pos - 8))
+      break;
+    if(memcmp(pos, "UNTR", 4) == 0)
+    {
+      String workTree = Directory::getCurrent();
+      workTree.subst("\\", "/");
+      if(!prefix.isEmpty())
+        workTree.setLength(workTree.getLength() - prefix.getLength() - 1);
+      readUntrackedCache(pos + 8, pos + 8 + size, workTree, prefixDir, hashSize);
+    }
+    pos += 8 + size;
+  }
+
+  this->path = indexPath;
+  return true;
+}
+
+void GitIndex::readUntrackedCache(const unsigned char* pos, const unsigned char* end, const String& workTree, const String& prefixDir, size_t hashSize)
+{
+  // the cache can only be used in the working tree it was written for
+  size_t identLength;
+  if(!readVarint(pos, end, identLength) || identLength > (size_t)(end - pos))
+    return;
+  String location("Location ");
+  location.append(workTree);
+  location.append(", ");
+  if(identLength < location.getLength() || strncmp((const char*)pos, location.getData(), location.getLength()) != 0)
+    return;
+  pos += identLength;
+
+  // skip the stat data and hashes of the exclude files and the name of the per-directory exclude file
+  size_t headerSize = 36 * 2 + 4 + hashSize * 2;
+  if((size_t)(end - pos) < headerSize)
+    return;
+  pos += headerSize;
+  String excludeFile;
+  if(!readString(pos, end, excludeFile))
+    return;
+
+  // read the directory blocks
+  size_t dirCount;
+  List<UntrackedDir> dirs;
+  if(!readVarint(pos, end, dirCount) || dirCount == 0 || !readUntrackedDir(pos, end, String(), dirs) || dirs.getSize() != dirCount)
+    return;
+
+  // a directory block is only complete if it is valid and if the directory was not just checked for containing any untracked files
+  Array<bool> valid, checkOnly, hashValid;
+  if(!readBitmap(pos, end, dirCount, valid) || !readBitmap(pos, end, dirCount, checkOnly) || !readBitmap(pos, end, dirCount, hashValid))
+    return;
+
+  // add the untracked files of the complete directory blocks with the modification time of the directory
+  size_t index = 0;
+  for(const List<UntrackedDir>::Node* i = dirs.getFirst(); i; i = i->getNext(), ++index)
+  {
+    if(!valid[index])
+      continue;
+    if((size_t)(end - pos) < 36)
+      return;
+    long long mtime = readTime(pos + 8);
+    pos += 36;
+    if(checkOnly[index])
+      continue;
+
+    const UntrackedDir& untrackedDir = i->data;
+    String dirpath;
+    if(!prefixDir.isEmpty())
+    {
+      String path = untrackedDir.path;
+      path.append('/');
+      if(strncmp(path.getData(), prefixDir.getData(), prefixDir.getLength()) != 0)
+        continue;
+      dirpath = path.substr(prefixDir.getLength());
+      if(!dirpath.isEmpty())
+        dirpath.setLength(dirpath.getLength() - 1);
+    }
+    else
+      dirpath = untrackedDir.path;
+    Entry* dir = getDir(dirpath);
+    dir->untrackedTime = mtime;
+    for(const List<String>::Node* j = untrackedDir.names.getFirst(); j; j = j->getNext())
+    {
+      const String& name = j->data;
+      Entry& entry = dir->entries.append();
+      if(!name.isEmpty() && name.getData()[name.getLength() - 1] == '/')
+      {
+        entry.name = name.substr(0, name.getLength() - 1);
+        entry.isDir = true;
+      }
+      else
+        entry.name = name;
+    }
+  }
+}
+
+GitIndex::Entry* GitIndex::getDir(const String& dirpath)
+{
+  Entry* dir = &root;
+  for(const char* str = dirpath.getData(); *str;)
+  {
+    const char* end = strchr(str, '/');
+    if(!end)
+      end = str + strlen(str);
+    size_t len = end - str;
+    if(len > 0)
+    {
+      List<Entry>::Node* i = dir->entries.getFirst();
+      for(; i; i = i->getNext())
+        if(i->data.isDir && i->data.name.getLength() == len && strncmp(i->data.name.getData(), str, len) == 0)
+          break;
+      if(i)
+        dir = &i->data;
+      else
+      {
+        Entry& entry = dir->entries.append();
+        entry.name = String(str, len);
+        entry.isDir = true;
+        dir = &entry;
+      }
+      dir->tracked = true; // so that findDir() can reach it
+    }
+    str = *end ? end + 1 : end;
+  }
+  return dir;
+}
+
+const GitIndex::Entry* GitIndex::findDir(const String& dirpath) const
+{
+  if(!root.tracked || File::isPathAbsolute(dirpath))
+    return 0;
+  const Entry* dir = &root;
+  for(const char* str = dirpath.getData(); *str;)
+  {
+    const char* end = str;
+    while(*end && *end != '/' && *end != '\\')
+      ++end;
+    size_t len = end - str;
+    if(len == 0 || (len == 1 && *str == '.'))
+      ;
+    else if(len == 2 && str[0] == '.' && str[1] == '.')
+      return 0;
+    else
+    {
+      const List<Entry>::Node* i = dir->entries.getFirst();
+      for(; i; i = i->getNext())
+        if(i->data.isDir && i->data.name.getLength() == len && strncmp(i->data.name.getData(), str, len) == 0)
+          break;
+      if(!i || !i->data.tracked)
+        return 0;
+      dir = &i->data;
+    }
+    str = *end ? end + 1 : end;
+  }
+  return dir;
+}
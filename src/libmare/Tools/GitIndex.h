@@ -0,0 +1,60 @@
+/**
+* @file GitIndex.h
+* Declaration of a class for reading the list of tracked files from the index of a Git working tree.
+* @author Colin Graf
+*/
+
+#pragma once
+
+#include "String.h"
+#include "List.h"
+
+/** A class for reading the list of tracked files (and the untracked files recorded by Git's untracked cache) from the index file (.git/index) of a Git working tree */
+class GitIndex
+{
+public:
+
+  /** A file or directory tracked in the index */
+  class Entry
+  {
+  public:
+    String name; /**< The name of the file or directory */
+    bool isDir; /**< Whether the entry is a directory */
+    bool tracked; /**< Whether the content of a directory is listed in the index (false for submodules, sparse directories and untracked directories) */
+    List<Entry> entries; /**< The entries of a directory (the tracked ones are sorted by name) */
+    long long untrackedTime; /**< The modification time of a directory when Git recorded its untracked files in \c entries or \c 0 if they are not known (see File::getWriteTime) */
+
+    Entry() : isDir(false), tracked(false), untrackedTime(0) {}
+  };
+
+  GitIndex() : writeTime(0) {}
+
+  /**
+  * Loads the index of the Git working tree that contains the current working directory
+  * @return Whether an index file was found and loaded successfully
+  */
+  bool load();
+
+  /**
+  * Searches a tracked directory in the index
+  * @param dirpath The path to the directory relative to the current working directory
+  * @return The directory entry or \c 0 if the directory is not tracked (e.g. because it is located outside of the working tree)
+  */
+  const Entry* findDir(const String& dirpath) const;
+
+  /** Returns the path to the loaded index file */
+  inline const String& getPath() const {return path;}
+
+  /** Returns the modification time of the loaded index file (see File::getWriteTime) */
+  inline long long getWriteTime() const {return writeTime;}
+
+private:
+  Entry root; /**< The entry of the current working directory */
+  String path; /**< The path to the index file */
+  long long writeTime; /**< The modification time of the index file */
+
+  static bool findGitDir(String& gitDir, String& prefix);
+
+  void readUntrackedCache(const unsigned char* pos, const unsigned char* end, const String& workTree, const String& prefixDir, size_t hashSize);
+  Entry* getDir(const String& dirpath);
+};
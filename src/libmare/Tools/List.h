@@ -9,8 +9,11 @@ public:
   public:
     T data;
 
-    Node() {}
+    Node() : data() {}
     Node(const T& data) : data(data) {}
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+    Node(T&& data) : data(static_cast<T&&>(data)) {}
+#endif
 
     inline Node* getNext() {return next;}
     inline const Node* getNext() const {return next;}
@@ -26,6 +29,18 @@ public:
 
   List() : first(0), last(0), size(0), firstFree(0) {}
 
+  List(const List& other) : first(0), last(0), size(0), firstFree(0)
+  {
+    *this = other;
+  }
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  List(List&& other) : first(0), last(0), size(0), firstFree(0)
+  {
+    swap(other);
+  }
+#endif
+
   ~List()
   {
     clear();
@@ -38,13 +53,39 @@ public:
 
   List& operator=(const List& other)
   {
-    clear();
-    for(Node* i = other.first; i; i = i->next)
-      append(i->data);
+    if(this != &other)
+    {
+      clear();
+      for(Node* i = other.first; i; i = i->next)
+        append(i->data);
+    }
     return *this;
   }
 
-  T& append(const T& data = T())
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  List& operator=(List&& other)
+  {
+    swap(other);
+    return *this;
+  }
+#endif
+
+  /** Appends an element that is constructed in place */
+  T& append()
+  {
+    Node* node;
+    if(firstFree)
+    {
+      node = firstFree;
+      firstFree = firstFree->next;
+      node->data = T();
+    }
+    else
+      node = new Node;
+    return linkLast(node);
+  }
+
+  T& append(const T& data)
   {
     Node* node;
     if(firstFree)
@@ -55,15 +96,24 @@ public:
     }
     else
       node = new Node(data);
-    node->next = 0;
-    if((node->previous = last))
-      last->next = node;
+    return linkLast(node);
+  }
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  T& append(T&& data)
+  {
+    Node* node;
+    if(firstFree)
+    {
+      node = firstFree;
+      firstFree = firstFree->next;
+      node->data = static_cast<T&&>(data);
+    }
     else
-      first = node;
-    last = node;
-    ++size;
-    return node->data;
+      node = new Node(static_cast<T&&>(data));
+    return linkLast(node);
   }
+#endif
 
   T& prepend(const T& data = T())
   {
@@ -124,6 +174,14 @@ public:
 
   inline bool isEmpty() const {return first == 0;}
 
+  void swap(List& other)
+  {
+    swap(first, other.first);
+    swap(last, other.last);
+    swap(size, other.size);
+    swap(firstFree, other.firstFree);
+  }
+
   /**
   * Sorts the list using the comparator \c cmp.
   * Note: This function may change the data element of an existing node.
@@ -138,9 +196,15 @@ public:
       int (*compare)(const T& a, const T& b);
       inline static void swap(Node* a, Node* b)
       {
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+        T tmp(static_cast<T&&>(a->data));
+        a->data = static_cast<T&&>(b->data);
+        b->data = static_cast<T&&>(tmp);
+#else
         T tmp = a->data;
         a->data = b->data;
         b->data = tmp;
+#endif
       }
       inline void sort(Node* left, Node* right)
       {
@@ -175,5 +239,24 @@ private:
   Node* last;
   unsigned int size;
   Node* firstFree;
+
+  template <typename V> static void swap(V& a, V& b)
+  {
+    V tmp = a;
+    a = b;
+    b = tmp;
+  }
+
+  T& linkLast(Node* node)
+  {
+    node->next = 0;
+    if((node->previous = last))
+      last->next = node;
+    else
+      first = node;
+    last = node;
+    ++size;
+    return node->data;
+  }
 };
 
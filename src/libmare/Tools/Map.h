@@ -1,6 +1,17 @@
 
 #pragma once
 
+#include <cstddef> // for size_t on Linux
+
+inline unsigned int hashKey(unsigned int key) {return key;}
+inline unsigned int hashKey(int key) {return (unsigned int)key;}
+inline unsigned int hashKey(unsigned long long key) {return (unsigned int)(key ^ (key >> 32));}
+template <typename T> inline unsigned int hashKey(T* key) {return (unsigned int)((size_t)key ^ ((size_t)key >> 4));}
+
+/**
+* A map that keeps its entries in insertion order. Maps with more than a few entries maintain a hash index for finding keys.
+* A key type has to provide a hashKey() function (see String.h).
+*/
 template <typename K, typename T> class Map
 {
 public:
@@ -10,7 +21,12 @@ public:
     K key;
     T data;
 
+    Node(const K& key) : key(key), data() {}
     Node(const K& key, const T& data) : key(key), data(data) {}
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+    Node(K&& key) : key(static_cast<K&&>(key)), data() {}
+    Node(K&& key, T&& data) : key(static_cast<K&&>(key)), data(static_cast<T&&>(data)) {}
+#endif
 
     inline Node* getNext() {return next;}
     inline const Node* getNext() const {return next;}
@@ -20,11 +36,25 @@ public:
   private:
     Node* next;
     Node* previous;
+    Node* nextInBucket;
+    unsigned int hashCode;
 
     friend class Map;
   };
 
-  Map() : first(0), last(0), size(0), firstFree(0) {}
+  Map() : first(0), last(0), size(0), firstFree(0), buckets(0), bucketCount(0) {}
+
+  Map(const Map& other) : first(0), last(0), size(0), firstFree(0), buckets(0), bucketCount(0)
+  {
+    *this = other;
+  }
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  Map(Map&& other) : first(0), last(0), size(0), firstFree(0), buckets(0), bucketCount(0)
+  {
+    swap(other);
+  }
+#endif
 
   ~Map()
   {
@@ -34,17 +64,45 @@ public:
       next = node->next;
       delete node;
     }
+    delete[] buckets;
   }
 
   Map& operator=(const Map& other)
   {
-    clear();
-    for(Node* i = other.first; i; i = i->next)
-      append(i->key, i->data);
+    if(this != &other)
+    {
+      clear();
+      for(Node* i = other.first; i; i = i->next)
+        append(i->key, i->data);
+    }
+    return *this;
+  }
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  Map& operator=(Map&& other)
+  {
+    swap(other);
     return *this;
   }
+#endif
 
-  T& append(const K& key, const T& data = T())
+  /** Appends an element with a value that is constructed in place */
+  T& append(const K& key)
+  {
+    Node* node;
+    if(firstFree)
+    {
+      node = firstFree;
+      firstFree = firstFree->next;
+      node->key = key;
+      node->data = T();
+    }
+    else
+      node = new Node(key);
+    return link(node);
+  }
+
+  T& append(const K& key, const T& data)
   {
     Node* node;
     if(firstFree)
@@ -56,18 +114,50 @@ public:
     }
     else
       node = new Node(key, data);
-    node->next = 0;
-    if((node->previous = last))
-      last->next = node;
+    return link(node);
+  }
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  T& append(K&& key)
+  {
+    Node* node;
+    if(firstFree)
+    {
+      node = firstFree;
+      firstFree = firstFree->next;
+      node->key = static_cast<K&&>(key);
+      node->data = T();
+    }
     else
-      first = node;
-    last = node;
-    ++size;
-    return node->data;
+      node = new Node(static_cast<K&&>(key));
+    return link(node);
   }
 
+  T& append(K&& key, T&& data)
+  {
+    Node* node;
+    if(firstFree)
+    {
+      node = firstFree;
+      firstFree = firstFree->next;
+      node->key = static_cast<K&&>(key);
+      node->data = static_cast<T&&>(data);
+    }
+    else
+      node = new Node(static_cast<K&&>(key), static_cast<T&&>(data));
+    return link(node);
+  }
+#endif
+
   void remove(Node* node)
   {
+    if(buckets)
+    {
+      Node** bucket = &buckets[node->hashCode & (bucketCount - 1)];
+      while(*bucket != node)
+        bucket = &(*bucket)->nextInBucket;
+      *bucket = node->nextInBucket;
+    }
     if(node->next)
       node->next->previous = node->previous;
     else
@@ -90,11 +180,24 @@ public:
       first = last = 0;
       size = 0;
     }
+    if(buckets)
+    {
+      delete[] buckets;
+      buckets = 0;
+      bucketCount = 0;
+    }
   }
 
   Node* find(const K& key)
   {
-    // TODO: use hash map
+    if(buckets)
+    {
+      unsigned int hashCode = hashKey(key);
+      for(Node* node = buckets[hashCode & (bucketCount - 1)]; node; node = node->nextInBucket)
+        if(node->hashCode == hashCode && node->key == key)
+          return node;
+      return 0;
+    }
     for(Node* node = first; node; node = node->next)
       if(node->key == key)
         return node;
@@ -103,20 +206,23 @@ public:
 
   const Node* find(const K& key) const
   {
-    // TODO: use hash map
-    for(const Node* node = first; node; node = node->next)
-      if(node->key == key)
-        return node;
-    return 0;
+    return const_cast<Map*>(this)->find(key);
+  }
+
+  void swap(Map& other)
+  {
+    swap(first, other.first);
+    swap(last, other.last);
+    swap(size, other.size);
+    swap(firstFree, other.firstFree);
+    swap(buckets, other.buckets);
+    swap(bucketCount, other.bucketCount);
   }
 
   T lookup(const K& key) const
   {
-    // TODO: use hash map
-    for(Node* node = first; node; node = node->next)
-      if(node->key == key)
-        return node->data;
-    return T();
+    const Node* node = find(key);
+    return node ? node->data : T();
   }
 
   inline Node* getFirst() {return first;}
@@ -129,9 +235,69 @@ public:
   inline bool isEmpty() const {return first == 0;}
 
 private:
+  enum
+  {
+    minIndexedSize = 16 /**< The size at which a map starts to use a hash index */
+  };
+
   Node* first;
   Node* last;
   unsigned int size;
   Node* firstFree;
-};
+  Node** buckets;
+  unsigned int bucketCount;
 
+  T& link(Node* node)
+  {
+    node->next = 0;
+    if((node->previous = last))
+      last->next = node;
+    else
+      first = node;
+    last = node;
+    ++size;
+    if(buckets)
+    {
+      node->hashCode = hashKey(node->key);
+      if(size > bucketCount)
+        rehash(bucketCount << 1);
+      else
+      {
+        Node** bucket = &buckets[node->hashCode & (bucketCount - 1)];
+        while(*bucket)
+          bucket = &(*bucket)->nextInBucket;
+        node->nextInBucket = 0;
+        *bucket = node;
+      }
+    }
+    else if(size > minIndexedSize)
+    {
+      for(Node* i = first; i; i = i->next)
+        i->hashCode = hashKey(i->key);
+      rehash(minIndexedSize << 2);
+    }
+    return node->data;
+  }
+
+  template <typename V> static void swap(V& a, V& b)
+  {
+    V tmp = a;
+    a = b;
+    b = tmp;
+  }
+
+  void rehash(unsigned int count)
+  {
+    delete[] buckets;
+    buckets = new Node*[count];
+    bucketCount = count;
+    for(unsigned int i = 0; i < count; ++i)
+      buckets[i] = 0;
+    for(Node* node = last; node; node = node->previous) // in reverse order, so that equal keys remain in insertion order
+    {
+      Node** bucket = &buckets[node->hashCode & (count - 1)];
+      node->nextInBucket = *bucket;
+      *bucket = node;
+    }
+  }
+};
@@ -0,0 +1,93 @@
+
+#include <cstring>
+
+#include "Pattern.h"
+
+Pattern::Pattern(const String& pattern) : type(literalType), pattern(pattern), prefixLength(pattern.getLength()), suffixLength(0)
+{
+  const char* str = pattern.getData();
+  const char* wildcard = strchr(str, '%');
+  if(!wildcard)
+    return;
+  const char* suffix = wildcard;
+  while(*suffix == '%')
+    ++suffix;
+  prefixLength = wildcard - str;
+  suffixLength = pattern.getLength() - (suffix - str);
+  type = strchr(suffix, '%') ? generalType : stemType;
+}
+
+bool Pattern::match(const char* str, size_t length)
+{
+  switch(type)
+  {
+  case literalType:
+    return length == prefixLength && memcmp(str, pattern.getData(), length) == 0;
+  case stemType:
+    return length >= prefixLength + suffixLength && memcmp(str, pattern.getData(), prefixLength) == 0 &&
+      memcmp(str + length - suffixLength, pattern.getData() + pattern.getLength() - suffixLength, suffixLength) == 0;
+  default:
+    word.clear();
+    word.append(str, length);
+    return word.patmatch(pattern);
+  }
+}
+
+bool Pattern::match(const char* str, size_t length, const char*& stem, size_t& stemLength)
+{
+  switch(type)
+  {
+  case literalType:
+    if(length != prefixLength || memcmp(str, pattern.getData(), length) != 0)
+      return false;
+    stem = str + length;
+    stemLength = 0;
+    return true;
+  case stemType:
+    if(length < prefixLength + suffixLength || memcmp(str, pattern.getData(), prefixLength) != 0 ||
+      memcmp(str + length - suffixLength, pattern.getData() + pattern.getLength() - suffixLength, suffixLength) != 0)
+      return false;
+    stem = str + prefixLength;
+    stemLength = length - prefixLength - suffixLength;
+    return true;
+  default:
+    {
+      word.clear();
+      word.append(str, length);
+      size_t stemStart;
+      if(!word.patmatch(pattern, stemStart, stemLength))
+        return false;
+      stem = str + stemStart;
+      return true;
+    }
+  }
+}
+
+Pattern::Replacement::Replacement(const String& replace) : hasStem(false)
+{
+  // unescape "\%" and find the first '%' (see String::patsubst)
+  for(const char* src = replace.getData(); *src; ++src)
+    if(*src == '\\' && (src[1] == '%' || (src[1] == '\\' && src[2] == '%')))
+    {
+      ++src;
+      head.append(*src);
+    }
+    else if(*src == '%')
+    {
+      hasStem = true;
+      tail = String(src + 1, -1);
+      break;
+    }
+    else
+      head.append(*src);
+}
+
+void Pattern::Replacement::appendTo(const char* stem, size_t stemLength, String& output) const
+{
+  output.append(head);
+  if(hasStem)
+  {
+    output.append(stem, stemLength);
+    output.append(tail);
+  }
+}
@@ -0,0 +1,72 @@
+
+#pragma once
+
+#include "String.h"
+
+/**
+* A pattern with '%' wildcards (see String::patmatch) that is analyzed once, so that matching it against many words is cheap.
+* Patterns without a wildcard and patterns with a single wildcard (e.g. "%.cpp", "lib%" or "src/%.c") are matched by comparing
+* the literal parts only. Other patterns use the general wildcard matcher.
+*/
+class Pattern
+{
+public:
+  Pattern(const String& pattern);
+
+  inline bool isLiteral() const {return type == literalType;}
+  inline const String& getPattern() const {return pattern;}
+
+  /**
+  * Checks whether a word matches the pattern
+  * @param str The word. It does not have to be terminated.
+  * @param length The length of the word
+  * @return Whether the word matches
+  */
+  bool match(const char* str, size_t length);
+
+  /**
+  * Checks whether a word matches the pattern and finds the part that was matched by the first wildcard
+  * @param str The word. It does not have to be terminated.
+  * @param length The length of the word
+  * @param stem The start of the part that was matched by the first wildcard
+  * @param stemLength The length of this part
+  * @return Whether the word matches
+  */
+  bool match(const char* str, size_t length, const char*& stem, size_t& stemLength);
+
+  /**
+  * A replacement string for String::patsubst like substitutions, where a '%' stands for the stem of the matched word
+  */
+  class Replacement
+  {
+  public:
+    Replacement(const String& replace);
+
+    /**
+    * Appends the replacement for a word to a string
+    * @param stem The stem of the word
+    * @param stemLength The length of the stem
+    * @param output The string
+    */
+    void appendTo(const char* stem, size_t stemLength, String& output) const;
+
+  private:
+    String head;
+    String tail;
+    bool hasStem;
+  };
+
+private:
+  enum Type
+  {
+    literalType, /**< A pattern without wildcards */
+    stemType, /**< A pattern with a single wildcard (or a single sequence of wildcards) */
+    generalType, /**< A pattern with several wildcards */
+  };
+
+  Type type;
+  String pattern;
+  size_t prefixLength;
+  size_t suffixLength; /**< The length of the part after the first wildcard(s) (at the end of \c pattern) */
+  String word; /**< A buffer for terminating words for the general wildcard matcher */
+};
@@ -11,23 +11,37 @@
 #include <cstdio>
 #include <cstring>
 #include <sys/utsname.h> // uname
+#include <spawn.h>
+#ifdef __linux
+#include <sched.h> // sched_getaffinity
+#endif
+#if defined(__APPLE__) && defined(__MACH__)
+#include <mach-o/dyld.h> // _NSGetExecutablePath
+#endif
 #endif
 
 #include "Assert.h"
 #include "Process.h"
 #include "Map.h"
 #include "File.h"
+#include "Directory.h"
 #include "Word.h"
-#ifdef _WIN32
 #include "Array.h"
-#else
-#include "Error.h"
-#endif
 
 #ifdef _WIN32
 static Array<HANDLE> runningProcessHandles;
 #else
 static Map<pid_t, Process*> runningProcesses;
+
+/** An environment for launching processes that was derived from the environment of this process by a set of overrides */
+class EnvironmentBlock
+{
+public:
+  Array<String> variables;
+  Array<const char*> envp; /**< Pointers to the variables (terminated by 0) */
+};
+
+static Map<String, EnvironmentBlock> environmentBlocks; /**< The environments for launching processes by their overrides */
 #endif
 
 Process::Process()
@@ -67,8 +81,9 @@ bool Process::isRunning() const
 #endif
 }
 
-unsigned int Process::start(const String& rawCommandLine)
+unsigned int Process::start(const String& rawCommandLine, const String& workingDirectory)
 {
+#ifdef _WIN32
   // split commands into words
   List<Word> command;
   Word::split(rawCommandLine, command);
@@ -104,7 +119,6 @@ unsigned int Process::start(const String& rawCommandLine)
       break;
   }
 
-#ifdef _WIN32
   struct Executable
   {
     static bool fileComplete(const String& searchName, bool testExtensions, String& result)
@@ -298,7 +312,8 @@ unsigned int Process::start(const String& rawCommandLine)
     *p = '\0';
   }
 
-  if(!CreateProcess(programPath.getData(), (char*)commandLine.getData(), NULL, NULL, FALSE, 0, envblock, NULL, &si, &pi))
+  const char* currentDirectory = workingDirectory.isEmpty() ? NULL : workingDirectory.getData();
+  if(!CreateProcess(programPath.getData(), (char*)commandLine.getData(), NULL, NULL, FALSE, 0, envblock, currentDirectory, &si, &pi))
   {
     DWORD lastError = GetLastError();
     if(!programPath.isEmpty())
@@ -307,7 +322,7 @@ unsigned int Process::start(const String& rawCommandLine)
       if(Executable::resolveSymlink(programPath, resolvedSymlink))
       {
         programPath = resolvedSymlink;
-        if(CreateProcess(programPath.getData(), (char*)commandLine.getData(), NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi))
+        if(CreateProcess(programPath.getData(), (char*)commandLine.getData(), NULL, NULL, FALSE, 0, NULL, currentDirectory, &si, &pi))
           goto success;
         else
           lastError = GetLastError();
@@ -443,11 +458,61 @@ success:
 #endif
   };
 
-  String program, programPath;
+  // split the command into views on its words, so that we do not have to copy each word
+  static Array<WordView> words;
+  words.clear();
+  Word::split(rawCommandLine, words);
+  const WordView* word = words.getFirst(), * end = words.getEnd();
+
+  // find or create an environment with the leading environment variables
+  const char* const* envp = environ;
+  if(word < end && memchr(word->data, '=', word->length))
+  {
+    static String overrides;
+    overrides.clear();
+    for(; word < end && memchr(word->data, '=', word->length); ++word)
+    {
+      overrides.append(word->data, word->length);
+      overrides.append('\0');
+    }
+
+    const Map<String, EnvironmentBlock>::Node* node = environmentBlocks.find(overrides);
+    if(node)
+      envp = node->data.envp.getFirst();
+    else
+    {
+      Map<String, String> environmentVariables;
+      environmentVariables = getEnvironmentVariables();
+      for(const char* data = overrides.getData(), * end = data + overrides.getLength(); data < end; data += strlen(data) + 1)
+      {
+        // add or override a variable
+        const char* sep = strchr(data, '=');
+        String key(data, sep - data);
+        Map<String, String>::Node* existingNode = environmentVariables.find(key);
+        if(existingNode)
+          existingNode->data = String(data, -1);
+        else
+          environmentVariables.append(key, String(data, -1));
+      }
+
+      EnvironmentBlock& block = environmentBlocks.append(overrides);
+      block.variables.setCapacity(environmentVariables.getSize());
+      for(const Map<String, String>::Node* i = environmentVariables.getFirst(); i; i = i->getNext())
+        block.variables.append(i->data);
+      block.envp.setCapacity(environmentVariables.getSize() + 1);
+      for(const String* i = block.variables.getFirst(), * end = block.variables.getEnd(); i < end; ++i)
+        block.envp.append(i->getData());
+      block.envp.append(0);
+      envp = block.envp.getFirst();
+    }
+  }
+
+  // find the executable
+  String programPath;
   static Map<String, String> cachedProgramPaths;
-  if(!command.isEmpty())
+  if(word < end)
   {
-    program = command.getFirst()->data;
+    String program(word->data, word->length);
     const Map<String, String>::Node* i = cachedProgramPaths.find(program);
     if(i)
       programPath = i->data;
@@ -458,42 +523,72 @@ success:
     }
   }
 
-  int r = vfork();
-  if(r == -1)
-    return 0;
-  else if(r != 0) // parent
+  // build the argument vector in buffers that are reused for each process
+  static String arguments;
+  static Array<const char*> argv;
+  arguments.clear();
+  for(const WordView* i = word; i < end; ++i)
   {
-    pid = r;
-    runningProcesses.append(pid, this);
-    return r;
+    arguments.append(i->data, i->length);
+    arguments.append('\0');
   }
-  else // child
+  argv.clear();
+  const char* argument = arguments.getData();
+  for(const WordView* i = word; i < end; argument += (i++)->length + 1)
+    argv.append(argument);
+  argv.append(0);
+
+  static posix_spawnattr_t* attributes = 0;
+#ifdef POSIX_SPAWN_USEVFORK
+  static posix_spawnattr_t vforkAttributes;
+  if(!attributes && posix_spawnattr_init(&vforkAttributes) == 0)
   {
-    const char** argv = (const char**)alloca(sizeof(const char*) * (command.getSize() + 1));
-    int i = 0;
-    for(const List<Word>::Node* j = command.getFirst(); j; j = j->getNext())
-      argv[i++] = j->data.getData();
-    argv[i] = 0;
-
-    const char** envp = (const char**)environ;
-    if(!environmentVariables.isEmpty())
-    {
-      envp = (const char**)alloca(sizeof(const char*) * (environmentVariables.getSize() + 1));
-      int i = 0;
-      for(const Map<String, String>::Node* j = environmentVariables.getFirst(); j; j = j->getNext())
-        envp[i++] = j->data.getData();
-      envp[i] = 0;
-    }
+    posix_spawnattr_setflags(&vforkAttributes, POSIX_SPAWN_USEVFORK);
+    attributes = &vforkAttributes;
+  }
+#endif
 
-    const char* executable = programPath.getData();
-    if(execve(executable, (char* const*)argv, (char* const*)envp) == -1)
+  // change into the working directory in the new process
+  posix_spawn_file_actions_t* fileActions = 0;
+  String previousDirectory;
+  if(!workingDirectory.isEmpty())
+  {
+    previousDirectory = Directory::getCurrent();
+    if(!File::isPathAbsolute(programPath) && strchr(programPath.getData(), '/'))
+      programPath = previousDirectory + "/" + programPath; // the path would be relative to the working directory otherwise
+#if (defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))) || defined(__APPLE__)
+    static posix_spawn_file_actions_t chdirActions;
+    if(posix_spawn_file_actions_init(&chdirActions) != 0)
+      return 0;
+    fileActions = &chdirActions;
+    int err = posix_spawn_file_actions_addchdir_np(fileActions, workingDirectory.getData());
+    if(err != 0)
     {
-      fprintf(stderr, "%s: %s\n", executable, Error::getString().getData());
-      _exit(EXIT_FAILURE);
+      posix_spawn_file_actions_destroy(fileActions);
+      errno = err;
+      return 0;
     }
-    ASSERT(false); // unreachable
+#else
+    // mare is single-threaded, so the new process can inherit a temporarily changed working directory
+    if(!Directory::change(workingDirectory))
+      return 0;
+#endif
+  }
+
+  pid_t newPid;
+  int err = posix_spawn(&newPid, programPath.getData(), fileActions, attributes, (char* const*)argv.getFirst(), (char* const*)envp);
+  if(fileActions)
+    posix_spawn_file_actions_destroy(fileActions);
+  else if(!previousDirectory.isEmpty())
+    Directory::change(previousDirectory);
+  if(err != 0)
+  {
+    errno = err;
     return 0;
   }
+  pid = newPid;
+  runningProcesses.append(pid, this);
+  return pid;
 #endif
 }
 
@@ -554,17 +649,230 @@ unsigned int Process::waitOne()
 #endif
 }
 
+#ifdef __linux
+/** Reads a small file like those in /proc or /sys */
+static bool readSystemFile(const String& file, String& content)
+{
+  File f;
+  if(!f.open(file))
+    return false;
+  content.clear();
+  char buffer[4096];
+  size_t i;
+  while((i = f.read(buffer, sizeof(buffer))) > 0)
+    content.append(buffer, i);
+  return true;
+}
+
+/**
+* Returns the directories of the cgroup of this process and of its parent cgroups (the innermost one first). The
+* directories are searched upwards, since a container does not always see the cgroup path of the host.
+* @param controller A cgroup v1 controller (e.g. "cpu") or \c 0 for the cgroup v2 hierarchy
+* @param dirs The directories
+*/
+static void getCgroupDirs(const char* controller, Array<String>& dirs)
+{
+  dirs.clear();
+  String cgroups;
+  if(!readSystemFile("/proc/self/cgroup", cgroups))
+    return;
+  for(const char* line = cgroups.getData(); *line;)
+  {
+    // <hierarchy id>:<controllers>:<path>
+    const char* end = strchr(line, '\n');
+    if(!end)
+      end = line + strlen(line);
+    const char* controllers = (const char*)memchr(line, ':', end - line);
+    const char* path = controllers ? (const char*)memchr(controllers + 1, ':', end - controllers - 1) : 0;
+    if(path)
+    {
+      String mount;
+      ++controllers;
+      if(!controller)
+      {
+        if(path == controllers && *line == '0')
+          mount = "/sys/fs/cgroup";
+      }
+      else
+      {
+        size_t length = strlen(controller);
+        for(const char* i = controllers; i < path; i += strcspn(i, ",:") + 1)
+          if(strncmp(i, controller, length) == 0 && (i[length] == ',' || i[length] == ':'))
+          {
+            mount = String("/sys/fs/cgroup/") + String(controllers, path - controllers);
+            break;
+          }
+      }
+      if(!mount.isEmpty())
+      {
+        String dir = mount + String(path + 1, end - path - 1);
+        while(dir.getLength() > mount.getLength() && dir.getData()[dir.getLength() - 1] == '/')
+          dir.setLength(dir.getLength() - 1);
+        for(;;)
+        {
+          dirs.append(dir);
+          if(dir.getLength() <= mount.getLength())
+            break;
+          dir = File::getDirname(dir);
+        }
+        return;
+      }
+    }
+    line = *end ? end + 1 : end;
+  }
+}
+
+/** Returns the number of processors granted by the CPU quota of the cgroup of this process or \c 0 if there is none */
+static unsigned int getCgroupProcessorLimit()
+{
+  unsigned int limit = 0;
+  Array<String> dirs;
+  String content;
+  getCgroupDirs(0, dirs);
+  for(const String* i = dirs.getFirst(), * end = dirs.getEnd(); i < end; ++i)
+  {
+    // "<quota> <period>" or "max <period>"
+    long long quota, period;
+    if(readSystemFile(*i + "/cpu.max", content) && sscanf(content.getData(), "%lld %lld", &quota, &period) == 2 && quota > 0 && period > 0)
+    {
+      unsigned int processors = (unsigned int)((quota + period - 1) / period);
+      if(limit == 0 || processors < limit)
+        limit = processors;
+    }
+  }
+  getCgroupDirs("cpu", dirs);
+  for(const String* i = dirs.getFirst(), * end = dirs.getEnd(); i < end; ++i)
+  {
+    long long quota, period;
+    String periodContent;
+    if(readSystemFile(*i + "/cpu.cfs_quota_us", content) && readSystemFile(*i + "/cpu.cfs_period_us", periodContent) &&
+       sscanf(content.getData(), "%lld", &quota) == 1 && sscanf(periodContent.getData(), "%lld", &period) == 1 && quota > 0 && period > 0)
+    {
+      unsigned int processors = (unsigned int)((quota + period - 1) / period);
+      if(limit == 0 || processors < limit)
+        limit = processors;
+    }
+  }
+  return limit;
+}
+#endif
+
 unsigned  int Process::getProcessorCount()
+{
+  static unsigned int processorCount = 0;
+  if(processorCount)
+    return processorCount;
+#if defined(_WIN32)
+  DWORD_PTR processMask, systemMask;
+  if(GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+    for(; processMask; processMask &= processMask - 1)
+      ++processorCount;
+  if(!processorCount)
+  {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    processorCount = si.dwNumberOfProcessors;
+  }
+#elif defined(__linux)
+  // the processors this process may run on (which excludes offline processors)
+  cpu_set_t set;
+  if(sched_getaffinity(0, sizeof(set), &set) == 0)
+    processorCount = CPU_COUNT(&set);
+  if(!processorCount)
+    processorCount = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+
+  // the CPU quota of a container
+  unsigned int limit = getCgroupProcessorLimit();
+  if(limit && limit < processorCount)
+    processorCount = limit;
+#else
+  processorCount = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if(!processorCount)
+    processorCount = 1;
+  return processorCount;
+}
+
+unsigned long long Process::getAvailableMemory()
 {
 #if defined(_WIN32)
-  SYSTEM_INFO si;
-  GetSystemInfo(&si);
-  return si.dwNumberOfProcessors;
-//#elif defined(__linux)
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  if(!GlobalMemoryStatusEx(&status))
+    return 0;
+  return status.ullAvailPhys;
+#elif defined(__linux)
+  unsigned long long memory = 0;
+  String content;
+  if(readSystemFile("/proc/meminfo", content))
+  {
+    const char* line = strstr(content.getData(), "MemAvailable:");
+    unsigned long long kb;
+    if(line && sscanf(line + 13, "%llu", &kb) == 1)
+      memory = kb * 1024;
+  }
+
+  // the memory limit of a container (its usage is ignored since it includes the page cache)
+  Array<String> dirs;
+  getCgroupDirs(0, dirs);
+  for(const String* i = dirs.getFirst(), * end = dirs.getEnd(); i < end; ++i)
+  {
+    unsigned long long limit;
+    if(readSystemFile(*i + "/memory.max", content) && sscanf(content.getData(), "%llu", &limit) == 1 && (memory == 0 || limit < memory))
+      memory = limit;
+  }
+  getCgroupDirs("memory", dirs);
+  for(const String* i = dirs.getFirst(), * end = dirs.getEnd(); i < end; ++i)
+  {
+    unsigned long long limit;
+    if(readSystemFile(*i + "/memory.limit_in_bytes", content) && sscanf(content.getData(), "%llu", &limit) == 1 && (memory == 0 || limit < memory))
+      memory = limit;
+  }
+  return memory;
+#else
+  return 0;
+#endif
+}
+
+String Process::getProgram(const String& commandLine)
+{
+  Array<WordView> words;
+  Word::split(commandLine, words);
+  for(const WordView* i = words.getFirst(), * end = words.getEnd(); i < end; ++i)
+    if(!memchr(i->data, '=', i->length))
+      return String(i->data, i->length);
+  return String();
+}
+
+String Process::getExecutablePath()
+{
+#ifdef _WIN32
+  char path[MAX_PATH];
+  DWORD len = GetModuleFileNameA(NULL, path, sizeof(path));
+  if(len == 0 || len >= sizeof(path))
+    return String();
+  return String(path, len);
+#elif defined(__APPLE__) && defined(__MACH__)
+  char path[4096];
+  uint32_t size = sizeof(path);
+  if(_NSGetExecutablePath(path, &size) != 0)
+    return String();
+  return String(path, -1);
+#else
+  char path[4096];
+  ssize_t len = readlink("/proc/self/exe", path, sizeof(path));
+  if(len <= 0 || len >= (ssize_t)sizeof(path))
+    return String();
+  return String(path, len);
+#endif
+}
+
+unsigned int Process::getCurrentProcessId()
+{
+#ifdef _WIN32
+  return (unsigned int)GetCurrentProcessId();
 #else
-  return sysconf(_SC_NPROCESSORS_CONF);
-//#else
-  //return 1;
+  return (unsigned int)getpid();
 #endif
 }
 
@@ -622,3 +930,22 @@ const Map<String, String>& Process::getEnvironmentVariables()
   loadedEnvironmentVariables = &environmentVariables;
   return environmentVariables;
 }
+
+void Process::setEnvironmentVariable(const String& key, const String& value)
+{
+  Map<String, String>& environmentVariables = const_cast<Map<String, String>&>(getEnvironmentVariables());
+  String variable = key;
+  variable.append('=');
+  variable.append(value);
+  Map<String, String>::Node* node = environmentVariables.find(key);
+  if(node)
+    node->data = variable;
+  else
+    environmentVariables.append(key, variable);
+#ifdef _WIN32
+  SetEnvironmentVariable(key.getData(), value.getData());
+#else
+  setenv(key.getData(), value.getData(), 1);
+  environmentBlocks.clear(); // they were derived from the previous environment
+#endif
+}
@@ -15,9 +15,10 @@ public:
   /**
   * Starts the execution of a process
   * @param command The command used to start the process. The first word in \c command should be a path to the executable. All other words in \c command are used as arguments for launching the process.
+  * @param workingDirectory The directory the process is started in. The process inherits the current directory if it is empty.
   * @return The process id of the newly started process or \c 0 if an errors occured
   */
-  unsigned int start(const String& command);
+  unsigned int start(const String& command, const String& workingDirectory = String());
 
   /**
   * Returns the running state of the process
@@ -29,8 +30,36 @@ public:
 
   static unsigned int waitOne();
 
+  /**
+  * Returns the number of processors this process can use. On Linux, this respects the CPU affinity of the process and
+  * the CPU quota of its cgroup (e.g. in a container).
+  * @return The number of processors
+  */
   static unsigned  int getProcessorCount();
 
+  /**
+  * Returns the amount of memory available to this process. On Linux, this is the available memory of the system unless
+  * the cgroup of the process has a lower memory limit.
+  * @return The amount of memory in bytes or \c 0 if it is unknown
+  */
+  static unsigned long long getAvailableMemory();
+
+  /**
+  * Returns the program that is launched by a command line (i.e. the first word that does not set an environment variable)
+  * @param commandLine The command line
+  * @return The name of the program
+  */
+  static String getProgram(const String& commandLine);
+
+  /**
+  * Returns the path to the executable of the current process
+  * @return The path or an empty string if it is unknown
+  */
+  static String getExecutablePath();
+
+  /** Returns the id of the current process */
+  static unsigned int getCurrentProcessId();
+
   static String getArchitecture();
 
   /**
@@ -39,6 +68,13 @@ public:
   */
   static const Map<String, String>& getEnvironmentVariables();
 
+  /**
+  * Sets an environment variable of the current process (and of the processes launched afterwards)
+  * @param key The name of the variable
+  * @param value The value of the variable
+  */
+  static void setEnvironmentVariable(const String& key, const String& value);
+
 private:
 #ifdef _WIN32
   void* hProcess;
@@ -0,0 +1,126 @@
+
+#include <cstring>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "Assert.h"
+#include "Scan.h"
+
+#ifdef HAVE_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+static inline unsigned int firstBit(unsigned int mask)
+{
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+}
+#else
+static inline unsigned int firstBit(unsigned int mask) {return __builtin_ctz(mask);}
+#endif
+
+/*
+The strings are read in aligned blocks of 16 bytes. An aligned block cannot cross a page boundary, so reading behind the
+terminating '\0' is safe. The bits of the bytes before the start of the string are masked out. (AddressSanitizer does not
+know that and has to be told to leave these reads alone.)
+*/
+
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8)))
+#define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define NO_SANITIZE_ADDRESS
+#endif
+
+static inline __m128i isSpace(__m128i block)
+{
+  // ' ' or '\t', '\n', '\v', '\f', '\r' (9 to 13)
+  __m128i control = _mm_sub_epi8(block, _mm_set1_epi8(9));
+  return _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control));
+}
+
+NO_SANITIZE_ADDRESS const char* Scan::find(const char* str, const char* chars)
+{
+  __m128i needles[8];
+  int count = 0;
+  needles[count++] = _mm_setzero_si128();
+  for(; *chars; ++chars)
+  {
+    ASSERT(count < 8);
+    needles[count++] = _mm_set1_epi8(*chars);
+  }
+
+  size_t offset = (size_t)str & 15;
+  const __m128i* pos = (const __m128i*)(str - offset);
+  unsigned int mask = (0xffff << offset) & 0xffff;
+  for(;; ++pos, mask = 0xffff)
+  {
+    __m128i block = _mm_load_si128(pos);
+    __m128i match = _mm_cmpeq_epi8(block, needles[0]);
+    for(int i = 1; i < count; ++i)
+      match = _mm_or_si128(match, _mm_cmpeq_epi8(block, needles[i]));
+    unsigned int bits = _mm_movemask_epi8(match) & mask;
+    if(bits)
+      return (const char*)pos + firstBit(bits);
+  }
+}
+
+NO_SANITIZE_ADDRESS const char* Scan::findSpace(const char* str)
+{
+  size_t offset = (size_t)str & 15;
+  const __m128i* pos = (const __m128i*)(str - offset);
+  unsigned int mask = (0xffff << offset) & 0xffff;
+  for(;; ++pos, mask = 0xffff)
+  {
+    __m128i block = _mm_load_si128(pos);
+    __m128i match = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_setzero_si128()), isSpace(block));
+    unsigned int bits = _mm_movemask_epi8(match) & mask;
+    if(bits)
+      return (const char*)pos + firstBit(bits);
+  }
+}
+
+NO_SANITIZE_ADDRESS const char* Scan::skipSpace(const char* str)
+{
+  size_t offset = (size_t)str & 15;
+  const __m128i* pos = (const __m128i*)(str - offset);
+  unsigned int mask = (0xffff << offset) & 0xffff;
+  for(;; ++pos, mask = 0xffff)
+  {
+    __m128i block = _mm_load_si128(pos);
+    unsigned int bits = ~_mm_movemask_epi8(isSpace(block)) & mask;
+    if(bits)
+      return (const char*)pos + firstBit(bits);
+  }
+}
+
+#else
+
+static inline bool isSpace(char c)
+{
+  return c == ' ' || (unsigned char)(c - 9) <= 4;
+}
+
+const char* Scan::find(const char* str, const char* chars)
+{
+  return str + strcspn(str, chars);
+}
+
+const char* Scan::findSpace(const char* str)
+{
+  while(*str && !isSpace(*str))
+    ++str;
+  return str;
+}
+
+const char* Scan::skipSpace(const char* str)
+{
+  while(isSpace(*str))
+    ++str;
+  return str;
+}
+
+#endif
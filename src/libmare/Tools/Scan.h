@@ -0,0 +1,31 @@
+
+#pragma once
+
+/**
+* Scanners for finding characters in NUL-terminated strings. They examine 16 bytes at once where SSE2 is available.
+*/
+class Scan
+{
+public:
+  /**
+  * Finds the first character of a string that is one of the given characters
+  * @param str The string
+  * @param chars The characters to look for (at most 7)
+  * @return The first matching character or the terminating '\0' of str
+  */
+  static const char* find(const char* str, const char* chars);
+
+  /**
+  * Finds the first white space character (see isspace()) of a string
+  * @param str The string
+  * @return The first white space character or the terminating '\0' of str
+  */
+  static const char* findSpace(const char* str);
+
+  /**
+  * Skips the white space characters at the beginning of a string
+  * @param str The string
+  * @return The first character that is not a white space character
+  */
+  static const char* skipSpace(const char* str);
+};
@@ -8,7 +8,6 @@
 #include "Assert.h"
 #include "String.h"
 
-String::Data String::emptyData("");
 String::Data* String::firstFreeData = 0;
 
 String::String(const char* str, ptrdiff_t length)
@@ -26,6 +25,15 @@ String::~String()
 void String::init(size_t capacity, const char* str, size_t length)
 {
   ASSERT(capacity >= length);
+  if(capacity <= inlineCapacity)
+  {
+    data = 0;
+    if(length)
+      memcpy(inlineStr, str, length);
+    inlineStr[length] = '\0';
+    inlineLength = (unsigned char)length;
+    return;
+  }
   if(firstFreeData)
   {
     data = firstFreeData;
@@ -54,6 +62,8 @@ void String::init(size_t capacity, const char* str, size_t length)
 
 void String::free()
 {
+  if(!data)
+    return;
   --data->refs;
   if(data->refs == 0)
   {
@@ -62,19 +72,31 @@ void String::free()
   }
 }
 
-void String::grow(size_t capacity, size_t length)
+char* String::grow(size_t capacity, size_t length)
 {
   ASSERT(capacity >= length);
-  ASSERT(length <= data->capacity);
-  if(data->refs > 1)
+  if(!data)
   {
+    ASSERT(length <= inlineCapacity);
+    if(capacity <= inlineCapacity)
+      return inlineStr;
+    char otherStr[inlineCapacity + 1];
+    memcpy(otherStr, inlineStr, length);
+    init(capacity, otherStr, length);
+  }
+  else if(data->refs > 1)
+  {
+    ASSERT(length <= data->capacity);
     Data* otherData = data;
     --otherData->refs;
 
     init(capacity, otherData->str, length);
+    if(!data)
+      return inlineStr;
   }
   else if(data->capacity < capacity)
   {
+    ASSERT(length <= data->capacity);
     char* otherStr = (char*)data->str;
     data->capacity = capacity + 16 + (capacity >> 1); // badass growing strategy
     data->str = new char[data->capacity + 1];
@@ -85,64 +107,74 @@ void String::grow(size_t capacity, size_t length)
     data->length = length;
     ((char*)data->str)[length] = '\0';
   }
+  return (char*)data->str;
 }
 
 String& String::operator=(const String& other)
 {
-  free();
-  data = other.data;
-  ++data->refs;
+  if(&other != this)
+  {
+    free();
+    copy(other);
+  }
   return *this;
 }
 
 bool String::operator==(const String& other) const
 {
-  return data->length == other.data->length && memcmp(data->str, other.data->str, data->length) == 0;
+  size_t length = getLength();
+  return length == other.getLength() && memcmp(getData(), other.getData(), length) == 0;
 }
 
 bool String::operator!=(const String& other) const
 {
-  return data->length != other.data->length || memcmp(data->str, other.data->str, data->length) != 0;
+  size_t length = getLength();
+  return length != other.getLength() || memcmp(getData(), other.getData(), length) != 0;
+}
+
+unsigned int String::hash() const
+{
+  unsigned int hash = 2166136261U; // FNV-1a
+  for(const unsigned char* str = (const unsigned char*)getData(), * end = str + getLength(); str < end; ++str)
+    hash = (hash ^ *str) * 16777619U;
+  return hash;
 }
 
 char* String::getData(size_t capacity)
 {
-  grow(capacity, 0);
-  return (char*)data->str;
+  return grow(capacity, 0);
 }
 
 void String::setCapacity(size_t capacity)
 {
-  grow(capacity < data->length ? data->length : capacity, data->length); // enforce detach
+  size_t length = getLength();
+  grow(capacity < length ? length : capacity, length); // enforce detach
 }
 
 String& String::append(char c)
 {
-  size_t newLength = data->length + 1;
-  grow(newLength, data->length);
-  ((char*)data->str)[data->length] = c;
-  ((char*)data->str)[newLength] = '\0';
-  data->length = newLength;
+  size_t length = getLength();
+  size_t newLength = length + 1;
+  char* str = grow(newLength, length);
+  str[length] = c;
+  str[newLength] = '\0';
+  setBufferLength(newLength);
   return *this;
 }
 
 String& String::append(const String& str)
 {
-  size_t newLength = data->length + str.data->length;
-  grow(newLength, data->length);
-  memcpy(((char*)data->str) + data->length, str.data->str, str.data->length);
-  ((char*)data->str)[newLength] = '\0';
-  data->length = newLength;
-  return *this;
+  return append(str.getData(), str.getLength());
 }
 
 String& String::append(const char* str, size_t length)
 {
-  size_t newLength = data->length + length;
-  grow(newLength, data->length);
-  memcpy(((char*)data->str) + data->length, str, length);
-  ((char*)data->str)[newLength] = '\0';
-  data->length = newLength;
+  size_t oldLength = getLength();
+  size_t newLength = oldLength + length;
+  char* buffer = grow(newLength, oldLength);
+  memcpy(buffer + oldLength, str, length);
+  buffer[newLength] = '\0';
+  setBufferLength(newLength);
   return *this;
 }
 
@@ -150,18 +182,20 @@ String& String::prepend(const String& str)
 {
   // TODO: optimize this using memmove when possible?
   String old(*this);
-  size_t newLength = data->length + str.data->length;
-  grow(newLength, 0);
-  memcpy((char*)data->str, str.data->str, str.data->length);
-  memcpy(((char*)data->str) + str.data->length, old.data->str, old.data->length);
-  ((char*)data->str)[newLength] = '\0';
-  data->length = newLength;
+  size_t length = str.getLength();
+  size_t oldLength = old.getLength();
+  size_t newLength = oldLength + length;
+  char* buffer = grow(newLength, 0);
+  memcpy(buffer, str.getData(), length);
+  memcpy(buffer + length, old.getData(), oldLength);
+  buffer[newLength] = '\0';
+  setBufferLength(newLength);
   return *this;
 }
 
 void String::clear()
 {
-  if(data->refs == 1)
+  if(data && data->refs == 1)
   {
     *(char*)data->str = '\0';
     data->length = 0;
@@ -169,71 +203,69 @@ void String::clear()
   else
   {
     free();
-    data = &emptyData;
-    ++data->refs;
+    data = 0;
+    *inlineStr = '\0';
+    inlineLength = 0;
   }
 }
 
 void String::setLength(size_t length)
 {
-  grow(length, length); // detach
-  ((char*)data->str)[length] = '\0';
-  data->length = length;
+  char* str = grow(length, length); // detach
+  str[length] = '\0';
+  setBufferLength(length);
 }
 
 String& String::format(size_t capacity, const char* format, ...)
 {
   int length;
+  char* str = getData(capacity);
   va_list ap;
   va_start(ap, format);
 #ifdef _MSC_VER
-  length = vsprintf_s(getData(capacity), capacity, format, ap);
+  length = vsprintf_s(str, capacity, format, ap);
 #else
-  length = ::vsnprintf(getData(capacity), capacity, format, ap);
+  length = ::vsnprintf(str, capacity, format, ap);
   if(length < 0)
     length = capacity;
 #endif
   va_end(ap);
-  ((char*)data->str)[length] = '\0';
-  data->length = length;
+  str[length] = '\0';
+  setBufferLength(length);
   return *this;
 }
 
 String String::substr(ptrdiff_t start, ptrdiff_t length) const
 {
+  size_t strLength = getLength();
   if(start < 0)
   {
-    start = data->length + start;
+    start = strLength + start;
     if(start < 0)
       start = 0;
   }
-  else if(static_cast<size_t>(start) > data->length)
-    start = data->length;
+  else if(static_cast<size_t>(start) > strLength)
+    start = strLength;
 
   size_t end;
   if(length >= 0)
   {
     end = start + length;
-    if(end > data->length)
-      end = data->length;
+    if(end > strLength)
+      end = strLength;
   }
   else
-    end = data->length;
-
-  length = end - start;
-  String result(length);
-  memcpy((char*)result.data->str, data->str + start, length);
-  ((char*)result.data->str)[length] = '\0';
-  result.data->length = length;
-  return result;
+    end = strLength;
+
+  return String(getData() + start, end - start);
 }
 
 int String::subst(const String& from, const String& to)
 {
-  String result(data->length + to.data->length * 2);
-  const char* str = data->str;
-  const char* f = from.data->str;
-  size_t flen = from.data->length;
+  String result(getLength() + to.getLength() * 2);
+  const char* str = getData();
+  const char* f = from.getData();
+  size_t flen = from.getLength();
   const char* start = str;
   int i = 0;
   while(*str)
@@ -256,12 +288,12 @@ int String::subst(const String& from, const String& to)
 
 bool String::find(const String& str, size_t& pos) const
 {
-  size_t needleLength = str.data->length;
+  size_t needleLength = str.getLength();
   if(needleLength == 0)
     return true;
   else
   {
-    size_t haystackLength = data->length;
+    size_t haystackLength = getLength();
     if(needleLength <= haystackLength)
     {
       if(needleLength * haystackLength > haystackLength + UCHAR_MAX + needleLength)
@@ -269,8 +301,8 @@ bool String::find(const String& str, size_t& pos) const
         // The BoyerMooreHorspool algorithm from http://en.wikipedia.org/wiki/Boyer-Moore-Horspool_algorithm
 
         size_t badCharShift[UCHAR_MAX + 1];
-        const unsigned char* needle = (const unsigned char*)(str.data->str);
-        const unsigned char* haystack = (const unsigned char*)(data->str);
+        const unsigned char* needle = (const unsigned char*)(str.getData());
+        const unsigned char* haystack = (const unsigned char*)(getData());
 
         for(unsigned int i = 0; i <= UCHAR_MAX; ++i)
           badCharShift[i] = needleLength;
@@ -280,14 +312,14 @@ bool String::find(const String& str, size_t& pos) const
         for(size_t i = 0; i < last; ++i)
           badCharShift[needle[i]] = last - i;
 
-        size_t haystackLength = data->length;
+        size_t haystackLength = getLength();
 
         while(haystackLength >= needleLength)
         {
           for(size_t i = last; haystack[i] == needle[i]; --i)
             if(i == 0)
             {
-              pos = static_cast<size_t>((const char*)haystack - data->str);
+              pos = static_cast<size_t>((const char*)haystack - getData());
               return true;
             }
 
@@ -297,10 +329,10 @@ bool String::find(const String& str, size_t& pos) const
       }
       else
       {
-        const char* res = strstr(data->str, str.data->str);
+        const char* res = strstr(getData(), str.getData());
         if(!res)
           return false;
-        pos = (size_t)(res - data->str);
+        pos = (size_t)(res - getData());
         return true;
       }
     }
@@ -316,10 +348,10 @@ bool String::contains(const String& str) const
 
 bool String::find(char ch, size_t& pos) const
 {
-  const char* res = strchr(data->str, ch);
+  const char* res = strchr(getData(), ch);
   if(res)
   {
-    pos = res - data->str;
+    pos = res - getData();
     return true;
   }
   return false;
@@ -330,20 +362,31 @@ static bool szWildMatch1(const char* pat, const char* str, const char*& matchsta
 
 bool String::patmatch(const String& pattern) const
 {
-  return szWildMatch7(pattern.data->str, data->str);
+  return szWildMatch7(pattern.getData(), getData());
+}
+
+bool String::patmatch(const String& pattern, size_t& stemStart, size_t& stemLength) const
+{
+  const char* matchstart;
+  const char* matchend;
+  if(!szWildMatch1(pattern.getData(), getData(), matchstart, matchend))
+    return false;
+  stemStart = matchstart - getData();
+  stemLength = matchend - matchstart;
+  return true;
 }
 
 bool String::patsubst(const String& pattern, const String& replace)
 {
   const char* matchstart;
   const char* matchend;
-  if(!szWildMatch1(pattern.data->str, data->str, matchstart, matchend))
+  if(!szWildMatch1(pattern.getData(), getData(), matchstart, matchend))
     return false;
 
   size_t matchlen = matchend - matchstart;
-  String result(matchlen + replace.data->length);
-  char* dest = (char*)result.data->str;
-  for(const char* src = replace.data->str; *src; ++src)
+  String result(matchlen + replace.getLength());
+  char* dest = result.getBuffer();
+  for(const char* src = replace.getData(); *src; ++src)
     if(*src == '\\' && (src[1] == '%' || (src[1] == '\\' && src[2] == '%')))
     {
       ++src;
@@ -354,7 +397,7 @@ bool String::patsubst(const String& pattern, const String& replace)
       memcpy(dest, matchstart, matchlen);
       dest += matchlen;
       ++src;
-      size_t left = replace.data->length - (src - replace.data->str);
+      size_t left = replace.getLength() - (src - replace.getData());
       memcpy(dest, src, left);
       dest += left;
       break;
@@ -362,7 +405,7 @@ bool String::patsubst(const String& pattern, const String& replace)
     else
       *(dest++) = *src;
   *dest = '\0';
-  result.data->length = dest - result.data->str;
+  result.setBufferLength(dest - result.getData());
   *this = result;
   return true;
 }
@@ -444,16 +487,16 @@ static bool szWildMatch1(const char* pat, const char* str, const char*& matchsta
 
 String& String::lowercase()
 {
-  grow(data->length, data->length); // detach
-  for(char* str = (char*)data->str; *str; ++str)
+  size_t length = getLength();
+  for(char* str = grow(length, length); *str; ++str) // detach
     *str = tolower(*(unsigned char*)str);
   return *this;
 }
 
 String& String::uppercase()
 {
-  grow(data->length, data->length); // detach
-  for(char* str = (char*)data->str; *str; ++str)
+  size_t length = getLength();
+  for(char* str = grow(length, length); *str; ++str) // detach
     *str = toupper(*(unsigned char*)str);
   return *this;
 }
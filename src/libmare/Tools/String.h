@@ -7,14 +7,29 @@
 #pragma once
 
 #include <cstddef> // for ptrdiff_t and size_t on Linux
+#include <cstring>
 
+/**
+* Strings of up to \c inlineCapacity characters are stored within the String object itself. Longer strings are kept in a
+* reference counted buffer that is shared between copies until one of them is modified.
+*/
 class String
 {
 public:
 
-  String() : data(&emptyData) {++data->refs;}
+  String() : data(0), inlineLength(0) {*inlineStr = '\0';}
 
-  String(const String& other) : data(other.data) {++data->refs;}
+  String(const String& other) {copy(other);}
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  String(String&& other)
+  {
+    if((data = other.data))
+      other.reset();
+    else
+      copy(other);
+  }
+#endif
 
   template <int N> String(const char (&str)[N]) {init(N - 1, str, N - 1);}
 
@@ -25,20 +40,34 @@ public:
   ~String();
 
   String& operator=(const String& other);
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  String& operator=(String&& other)
+  {
+    if(!other.data || &other == this)
+      return *this = other;
+    free();
+    data = other.data;
+    other.reset();
+    return *this;
+  }
+#endif
   inline String& operator+=(const String& other) {return append(other);}
   inline String operator+(const String& other) const {return String(*this).append(other);}
 
   bool operator==(const String& other) const;
   bool operator!=(const String& other) const;
 
-  inline const char* getData() const {return data->str;}
+  /** Returns a hash code of the string (e.g. for finding it in a Map) */
+  unsigned int hash() const;
+
+  inline const char* getData() const {return data ? data->str : inlineStr;}
 
   char* getData(size_t capacity);
 
   void setCapacity(size_t capacity);
 
   void setLength(size_t length);
-  inline size_t getLength() const {return data->length;}
+  inline size_t getLength() const {return data ? data->length : inlineLength;}
 
   String& format(size_t capacity, const char* format, ...);
 
@@ -49,11 +78,21 @@ public:
   String& append(const char* str, size_t length);
 
   void clear();
-  bool isEmpty() const {return data->length == 0;}
+  bool isEmpty() const {return getLength() == 0;}
 
   String substr(ptrdiff_t start, ptrdiff_t length = -1) const;
 
   bool patmatch(const String& pattern) const;
+
+  /**
+  * Like patmatch(pattern), but also finds the part of this String that was matched by the first '%' of the pattern.
+  *
+  * @param pattern The pattern
+  * @param stemStart The position of the matched part
+  * @param stemLength The length of the matched part
+  * @return Returns whether the pattern matches.
+  */
+  bool patmatch(const String& pattern, size_t& stemStart, size_t& stemLength) const;
   bool patsubst(const String& pattern, const String& replace);
 
   int subst(const String& from, const String& to);
@@ -83,16 +122,51 @@ private:
     Data* next;
 
     Data() {}
+  };
 
-    template <size_t N> Data(const char (&str)[N]) : str(str), length(N - 1), capacity(0), refs(1) {}
+  enum
+  {
+    inlineCapacity = sizeof(void*) * 2 - 2 /**< The maximum length of a string that is stored without a Data buffer */
   };
 
-  Data* data;
+  Data* data; /**< The buffer of a long string or 0 if the string is stored in \c inlineStr */
+  char inlineStr[inlineCapacity + 1];
+  unsigned char inlineLength;
 
-  static Data emptyData;
   static Data* firstFreeData;
 
   void init(size_t capacity, const char* str, size_t length);
   void free();
-  void grow(size_t capacity, size_t length);
+  char* grow(size_t capacity, size_t length);
+
+  inline void copy(const String& other)
+  {
+    if((data = other.data))
+      ++data->refs;
+    else
+    {
+      memcpy(inlineStr, other.inlineStr, sizeof(inlineStr));
+      inlineLength = other.inlineLength;
+    }
+  }
+
+  /** Turns this string into an empty string without releasing its buffer (that has been handed over to another string) */
+  inline void reset()
+  {
+    data = 0;
+    *inlineStr = '\0';
+    inlineLength = 0;
+  }
+
+  inline char* getBuffer() {return data ? (char*)data->str : inlineStr;}
+
+  inline void setBufferLength(size_t length)
+  {
+    if(data)
+      data->length = length;
+    else
+      inlineLength = (unsigned char)length;
+  }
 };
+
+inline unsigned int hashKey(const String& key) {return key.hash();}
@@ -2,6 +2,7 @@
 #include <cctype>
 #include <cstring>
 
+#include "Scan.h"
 #include "Word.h"
 
 Word& Word::operator=(const Word& other)
@@ -29,43 +30,49 @@ bool Word::operator!=(const Word& other) const
 
 String Word::first(const String& text)
 {
-  List<Word> words;
+  Array<WordView> words;
   split(text, words);
-  return words.isEmpty() ? String() : words.getFirst()->data;
+  return words.isEmpty() ? String() : String(words.getFirst()->data, words.getFirst()->length);
 }
 
 void Word::split(const String& text, List<Word>& words)
+{
+  Array<WordView> views;
+  split(text, views);
+  for(const WordView* i = views.getFirst(), * end = views.getEnd(); i < end; ++i)
+    words.append(i->toWord());
+}
+
+void Word::split(const String& text, Array<WordView>& words)
 {
   const char* str = text.getData();
   for(;;)
   {
-    while(isspace(*(unsigned char*)str))
-      ++str;
+    str = Scan::skipSpace(str);
     if(!*str)
       break;
     if(*str == '"')
     {
       ++str;
       const char* end = str;
-      for(; *end; ++end)
-        if(*end == '\\' && end[1] == '"')
-          ++end;
-        else if(*end == '"')
+      for(;;)
+      {
+        end = Scan::find(end, "\\\"");
+        if(*end != '\\')
           break;
+        end += end[1] == '"' ? 2 : 1;
+      }
       if(end > str) // TODO: read escaped spaces as ordinary spaces?
-        words.append(Word(text.substr(str - text.getData(), end - str), Word::quotedFlag));
+        words.append(WordView(str, end - str, Word::quotedFlag));
       str = end;
       if(*str)
         ++str; // skip closing '"'
     }
     else
     {
-      const char* end = str;
-      for(; *end; ++end)
-        if(isspace(*(unsigned char*)end))
-          break;
+      const char* end = Scan::findSpace(str);
       // TODO: read escaped spaces as ordinary spaces
-      words.append(Word(text.substr(str - text.getData(), end - str), 0));
+      words.append(WordView(str, end - str, 0));
       str = end;
     }
   }
@@ -104,17 +111,26 @@ void Word::appendTo(String& text) const
     text.append(*this);
 }
 
-void Word::splitLines(const String& text, List<Word>& words)
+void WordView::appendTo(String& text) const
+{
+  if(flags & Word::quotedFlag)
+  {
+    text.append('"');
+    text.append(data, length);
+    text.append('"');
+  }
+  else // TODO: escape spaces using blackslashes
+    text.append(data, length);
+}
+
+void Word::splitLines(const String& text, Array<WordView>& words)
 {
   const char* str = text.getData();
   for(;;)
   {
-    const char* end = str;
-    for(; *end; ++end)
-      if(*end == '\n' || *end == '\r')
-        break;
+    const char* end = Scan::find(str, "\n\r");
     // TODO: read escaped spaces as ordinary spaces
-    words.append(Word(text.substr(str - text.getData(), end - str), 0));
+    words.append(WordView(str, end - str, 0));
     str = end;
     if(*str)
     {
@@ -3,6 +3,9 @@
 
 #include "String.h"
 #include "List.h"
+#include "Array.h"
+
+class WordView;
 
 class Word : public String
 {
@@ -18,9 +21,22 @@ public:
   unsigned int flags;
 
   Word(const String& word, unsigned int flags) : String(word), flags(flags) {}
+  Word(const Word& other) : String(other), flags(other.flags) {}
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  Word(String&& word, unsigned int flags) : String(static_cast<String&&>(word)), flags(flags) {}
+  Word(Word&& other) : String(static_cast<String&&>(other)), flags(other.flags) {}
+#endif
 
   Word& operator=(const Word& other);
   Word& operator=(const String& other);
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+  Word& operator=(Word&& other)
+  {
+    (String&)*this = static_cast<String&&>(other);
+    flags = other.flags;
+    return *this;
+  }
+#endif
 
   bool operator==(const Word& other) const;
   bool operator!=(const Word& other) const;
@@ -36,5 +52,31 @@ public:
 
   static void split(const String& text, List<Word>& words);
   static void append(const List<Word>& words, String& text);
-  static void splitLines(const String& text, List<Word>& words);
+
+  /**
+  * Splits a string into words without copying them
+  * @param text The string. It has to outlive the views and must not be modified while they are in use.
+  * @param words The views on the words of the string are appended to this array
+  */
+  static void split(const String& text, Array<WordView>& words);
+  static void splitLines(const String& text, Array<WordView>& words);
+};
+
+/**
+* A word that references a slice of the string it was split from
+*/
+class WordView
+{
+public:
+  const char* data;
+  size_t length;
+  unsigned int flags;
+
+  WordView() {}
+  WordView(const char* data, size_t length, unsigned int flags) : data(data), length(length), flags(flags) {}
+
+  /** Creates an owned copy of the word (e.g. for storing it in a Namespace) */
+  inline Word toWord() const {return Word(String(data, length), flags);}
+
+  void appendTo(String& text) const;
 };
@@ -0,0 +1,197 @@
+
+#include <cstring>
+#include <cstdio>
+
+#include "Tools/Array.h"
+#include "Tools/List.h"
+#include "Tools/Word.h"
+#include "Tools/Scan.h"
+#include "Tools/File.h"
+#include "Tools/Directory.h"
+#include "Tools/Error.h"
+
+#include "Builtin.h"
+
+static bool fail(const char* name, const String& file, String& error)
+{
+  String message = Error::getString();
+  error = String("mare:");
+  error.append(name, strlen(name));
+  error.append(": ");
+  error.append(file);
+  error.append(": ");
+  error.append(message);
+  return false;
+}
+
+static bool usage(const char* name, const char* arguments, String& error)
+{
+  error = String("usage: mare:");
+  error.append(name, strlen(name));
+  error.append(' ');
+  error.append(arguments, strlen(arguments));
+  return false;
+}
+
+static bool copyFiles(const Array<String>& args, String& error)
+{
+  if(args.getSize() < 2)
+    return usage("cp", "<src> ... <dest>", error);
+  const String& dest = args[args.getSize() - 1];
+  bool intoDir = args.getSize() > 2 || Directory::exists(dest);
+  for(const String* i = args.getFirst(), * end = args.getEnd() - 1; i < end; ++i)
+  {
+    String destFile = dest;
+    if(intoDir)
+    {
+      destFile.append('/');
+      destFile.append(File::getBasename(*i));
+    }
+    if(!File::copy(*i, destFile))
+      return fail("cp", *i, error);
+  }
+  return true;
+}
+
+static bool makeDirectories(const Array<String>& args, String& error)
+{
+  for(const String* i = args.getFirst(), * end = args.getEnd(); i < end; ++i)
+    if(!Directory::create(*i))
+      return fail("mkdir", *i, error);
+  return true;
+}
+
+static bool removeFiles(const Array<String>& args, String& error)
+{
+  for(const String* i = args.getFirst(), * end = args.getEnd(); i < end; ++i)
+    if(!File::unlink(*i) && File::exists(*i))
+      return fail("rm", *i, error);
+  return true;
+}
+
+static bool touchFiles(const Array<String>& args, String& error)
+{
+  for(const String* i = args.getFirst(), * end = args.getEnd(); i < end; ++i)
+    if(!File::touch(*i))
+      return fail("touch", *i, error);
+  return true;
+}
+
+static bool linkFile(const Array<String>& args, String& error)
+{
+  if(args.getSize() != 2)
+    return usage("ln", "<target> <link>", error);
+  if(!File::link(args[0], args[1]))
+    return fail("ln", args[1], error);
+  return true;
+}
+
+static bool echoWords(const Array<String>& args, String& error)
+{
+  String text;
+  String file;
+  File::Flags flags = File::writeFlag;
+  for(const String* i = args.getFirst(), * end = args.getEnd(); i < end; ++i)
+  {
+    const char* arg = i->getData();
+    if(*arg == '>')
+    {
+      if(arg[1] == '>')
+      {
+        flags = (File::Flags)(File::writeFlag | File::appendFlag);
+        ++arg;
+      }
+      ++arg;
+      if(*arg)
+        file = String(arg, -1);
+      else if(++i < end)
+        file = *i;
+      if(file.isEmpty() || i + 1 < end)
+        return usage("echo", "<word> ... [> <file> | >> <file>]", error);
+      break;
+    }
+    if(!text.isEmpty())
+      text.append(' ');
+    text.append(*i);
+  }
+  text.append('\n');
+
+  if(file.isEmpty())
+  {
+    fwrite(text.getData(), 1, text.getLength(), stdout);
+    fflush(stdout);
+    return true;
+  }
+  File f;
+  if(!f.open(file, flags) || !f.write(text))
+    return fail("echo", file, error);
+  return true;
+}
+
+static const struct Command
+{
+  const char* name;
+  bool (*function)(const Array<String>& args, String& error);
+  const char* shellCommand;
+} commands[] = {
+  {"cp", copyFiles, "cp"},
+  {"mkdir", makeDirectories, "mkdir -p"},
+  {"rm", removeFiles, "rm -f"},
+  {"touch", touchFiles, "touch"},
+  {"ln", linkFile, "ln -sfn"},
+  {"echo", echoWords, "echo"},
+};
+
+static const Command* findCommand(const char* name, size_t length)
+{
+  for(const Command* i = commands, * end = commands + sizeof(commands) / sizeof(*commands); i < end; ++i)
+    if(strncmp(i->name, name, length) == 0 && i->name[length] == '\0')
+      return i;
+  return 0;
+}
+
+bool Builtin::isBuiltin(const String& command)
+{
+  return strncmp(Scan::skipSpace(command.getData()), "mare:", 5) == 0;
+}
+
+bool Builtin::execute(const String& command, String& error)
+{
+  Array<WordView> words;
+  Word::split(command, words);
+  const WordView& name = *words.getFirst();
+  const Command* builtin = findCommand(name.data + 5, name.length - 5);
+  if(!builtin)
+  {
+    error = String(name.data, name.length);
+    error.append(": unknown built-in command");
+    return false;
+  }
+
+  Array<String> args;
+  args.setCapacity(words.getSize() - 1);
+  for(const WordView* i = words.getFirst() + 1, * end = words.getEnd(); i < end; ++i)
+    args.append(String(i->data, i->length));
+  return builtin->function(args, error);
+}
+
+String Builtin::getShellCommand(const String& command)
+{
+  const char* str = Scan::skipSpace(command.getData());
+  if(strncmp(str, "mare:", 5) != 0)
+    return command;
+  const char* end = Scan::findSpace(str);
+  const Command* builtin = findCommand(str + 5, end - str - 5);
+  if(!builtin)
+    return command;
+  String result(builtin->shellCommand, -1);
+  result.append(end, command.getLength() - (end - command.getData()));
+  return result;
+}
+
+void Builtin::getShellCommands(List<String>& commands)
+{
+  for(List<String>::Node* i = commands.getFirst(); i; i = i->getNext())
+    if(isBuiltin(i->data))
+      i->data = getShellCommand(i->data);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Tools/String.h"
+#include "Tools/List.h"
+
+/**
+* Commands for common file operations that are executed within mare instead of a new process. A built-in command starts
+* with "mare:" followed by the name of the command:
+*
+* mare:cp <src> ... <dest> - Copies files (into <dest> if it is a directory or if there is more than one file)
+* mare:mkdir <dir> ... - Creates directories and their parent directories if they do not exist
+* mare:rm <file> ... - Removes files (but ignores files that do not exist)
+* mare:touch <file> ... - Creates files or sets their modification time to the current time
+* mare:ln <target> <link> - Creates a symbolic link (or replaces an existing one)
+* mare:echo <word> ... [> <file> | >> <file>] - Prints words (or writes them to a file or appends them to a file)
+*/
+class Builtin
+{
+public:
+
+  static bool isBuiltin(const String& command);
+
+  /**
+  * Executes a built-in command
+  * @param command The command
+  * @param error A message that describes the error if the command failed
+  * @return Whether the command was executed successfully
+  */
+  static bool execute(const String& command, String& error);
+
+  /**
+  * Translates a built-in command into a command for a POSIX shell (e.g. for Makefiles)
+  * @param command The command. Commands that are not built-in are returned unchanged.
+  * @return The shell command
+  */
+  static String getShellCommand(const String& command);
+
+  /**
+  * Translates the built-in commands of a list into commands for a POSIX shell
+  * @param commands The commands
+  */
+  static void getShellCommands(List<String>& commands);
+};
@@ -10,6 +10,7 @@
 #include "Tools/Error.h"
 #include "Tools/Word.h"
 
+#include "Builtin.h"
 #include "CodeBlocks.h"
 
 bool CodeBlocks::generate(const Map<String, String>& userArgs)
@@ -140,6 +141,10 @@ bool CodeBlocks::readFile()
         projectConfig.buildDir = engine.getFirstKey("buildDir", true);
 
         engine.getText("command", projectConfig.command, false);
+        Builtin::getShellCommands(projectConfig.buildCommand);
+        Builtin::getShellCommands(projectConfig.reBuildCommand);
+        Builtin::getShellCommands(projectConfig.cleanCommand);
+        Builtin::getShellCommands(projectConfig.command);
         projectConfig.firstOutput = engine.getFirstKey("output", false);
 
         if(!projectConfig.command.isEmpty())
@@ -9,6 +9,7 @@
 #include "Tools/Error.h"
 #include "Tools/Word.h"
 
+#include "Builtin.h"
 #include "Generator.h"
 
 bool Generator::generate(const Map<String, String>& userArgs)
@@ -98,6 +99,15 @@ bool Generator::readFile(Data& data)
 
         engine.getKeys("dependencies", target.dependencies, false);
 
+        // the generated project files cannot run built-in commands
+        Builtin::getShellCommands(target.buildCommand);
+        Builtin::getShellCommands(target.reBuildCommand);
+        Builtin::getShellCommands(target.cleanCommand);
+        Builtin::getShellCommands(target.preBuildCommand);
+        Builtin::getShellCommands(target.preLinkCommand);
+        Builtin::getShellCommands(target.postBuildCommand);
+        Builtin::getShellCommands(target.command);
+
         engine.getKeys("cppFlags", target.cppFlags, true);
         engine.getKeys("cFlags", target.cFlags, true);
         engine.getKeys("linkFlags", target.linkFlags, true);
@@ -125,6 +135,7 @@ bool Generator::readFile(Data& data)
             file.folder = engine.getFirstKey("folder", false);
 
             engine.getText("command", file.command, false);
+            Builtin::getShellCommands(file.command);
             engine.getText("message", file.message, false);
             engine.getKeys("output", file.output, false);
             engine.getKeys("input", file.input, false);
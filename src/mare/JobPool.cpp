@@ -0,0 +1,199 @@
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#endif
+#include <ctime>
+
+#include "Tools/Directory.h"
+#include "Tools/File.h"
+
+#include "JobPool.h"
+
+#ifdef _WIN32
+#define INVALID_LOCK_FILE INVALID_HANDLE_VALUE
+#else
+#define INVALID_LOCK_FILE (-1)
+#endif
+
+JobPool::JobPool() : nextSlot(0), instanceFile(INVALID_LOCK_FILE), instanceCount(1), instanceCountTime(0) {}
+
+JobPool::~JobPool()
+{
+  while(!heldSlots.isEmpty())
+    release();
+  for(const Handle* i = slots.getFirst(), * end = slots.getEnd(); i < end; ++i)
+    closeLockFile(*i);
+  if(instanceFile != INVALID_LOCK_FILE)
+  {
+    closeLockFile(instanceFile);
+    File::unlink(instanceFileName);
+  }
+}
+
+bool JobPool::open(const String& dir, unsigned int size)
+{
+  this->dir = dir;
+  if(!Directory::exists(dir))
+  {
+    if(!Directory::create(dir))
+      return false;
+#ifndef _WIN32
+    chmod(dir.getData(), 01777); // the pool is shared by all users
+#endif
+  }
+
+  // register this instance
+#ifdef _WIN32
+  instanceFileName.format(dir.getLength() + 32, "%s/instance-%u", dir.getData(), (unsigned int)GetCurrentProcessId());
+#else
+  instanceFileName.format(dir.getLength() + 32, "%s/instance-%u", dir.getData(), (unsigned int)getpid());
+#endif
+  if(!openLockFile(instanceFileName, instanceFile))
+    return false;
+  if(!lock(instanceFile))
+  {
+    closeLockFile(instanceFile);
+    instanceFile = INVALID_LOCK_FILE;
+    return false;
+  }
+
+  // open the lock files of the slots
+  slots.setCapacity(size);
+  for(unsigned int i = 0; i < size; ++i)
+  {
+    Handle handle;
+    if(!openLockFile(String().format(dir.getLength() + 32, "%s/slot-%u", dir.getData(), i), handle))
+    {
+      for(const Handle* i = slots.getFirst(), * end = slots.getEnd(); i < end; ++i)
+        closeLockFile(*i);
+      slots.clear();
+      closeLockFile(instanceFile);
+      instanceFile = INVALID_LOCK_FILE;
+      File::unlink(instanceFileName);
+      return false;
+    }
+    slots.append(handle);
+  }
+  return true;
+}
+
+bool JobPool::isOpen() const
+{
+  return instanceFile != INVALID_LOCK_FILE;
+}
+
+bool JobPool::acquire()
+{
+  unsigned int size = (unsigned int)slots.getSize();
+  if(size == 0)
+    return false;
+  unsigned int instances = countInstances();
+  if(heldSlots.getSize() >= (size + instances - 1) / instances)
+    return false;
+  for(unsigned int i = 0; i < size; ++i)
+  {
+    unsigned int slot = (nextSlot + i) % size;
+    bool held = false;
+    for(const unsigned int* j = heldSlots.getFirst(), * end = heldSlots.getEnd(); j < end; ++j)
+      if(*j == slot)
+      {
+        held = true;
+        break;
+      }
+    if(!held && lock(slots[slot]))
+    {
+      heldSlots.append(slot);
+      nextSlot = slot + 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+void JobPool::release()
+{
+  if(heldSlots.isEmpty())
+    return;
+  unsigned int slot = heldSlots[heldSlots.getSize() - 1];
+  heldSlots.setSize(heldSlots.getSize() - 1);
+  unlock(slots[slot]);
+}
+
+unsigned int JobPool::countInstances()
+{
+  // the instances are counted at most once a second
+  long long now = (long long)time(0);
+  if(now == instanceCountTime)
+    return instanceCount;
+  instanceCountTime = now;
+
+  unsigned int count = 1;
+  Directory directory;
+  if(directory.open(dir, "instance-*", false))
+  {
+    String name;
+    bool isDir;
+    String ownName = File::getBasename(instanceFileName);
+    while(directory.read(name, isDir))
+    {
+      if(isDir || name == ownName)
+        continue;
+      Handle handle;
+      if(!openLockFile(dir + "/" + name, handle))
+        continue;
+      if(lock(handle)) // the instance does not run anymore
+        unlock(handle);
+      else
+        ++count;
+      closeLockFile(handle);
+    }
+  }
+  instanceCount = count;
+  return count;
+}
+
+bool JobPool::openLockFile(const String& file, Handle& handle)
+{
+#ifdef _WIN32
+  handle = CreateFile(file.getData(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+#else
+  handle = ::open(file.getData(), O_RDONLY | O_CREAT | O_CLOEXEC, 0644); // locking does not require write access
+#endif
+  return handle != INVALID_LOCK_FILE;
+}
+
+bool JobPool::lock(Handle handle)
+{
+#ifdef _WIN32
+  OVERLAPPED overlapped;
+  ZeroMemory(&overlapped, sizeof(overlapped));
+  return LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped) != FALSE;
+#else
+  return flock(handle, LOCK_EX | LOCK_NB) == 0;
+#endif
+}
+
+void JobPool::unlock(Handle handle)
+{
+#ifdef _WIN32
+  OVERLAPPED overlapped;
+  ZeroMemory(&overlapped, sizeof(overlapped));
+  UnlockFileEx(handle, 0, 1, 0, &overlapped);
+#else
+  flock(handle, LOCK_UN);
+#endif
+}
+
+void JobPool::closeLockFile(Handle handle)
+{
+#ifdef _WIN32
+  CloseHandle(handle);
+#else
+  ::close(handle);
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Tools/Array.h"
+#include "Tools/String.h"
+
+/**
+* A pool of job slots that is shared by all mare instances of a host. The pool is a directory with a lock file for
+* each slot. A slot is taken by locking its file, so that the slots of an instance that crashed are freed by the
+* operating system. Like a make with a jobserver, each instance runs its first job without a slot, so that it never
+* has to wait for another instance before it starts. Each instance also locks a file of its own, which is used for
+* counting the running instances. An instance takes no more than its fair share of the slots.
+*/
+class JobPool
+{
+public:
+
+  JobPool();
+
+  /** Frees all slots and leaves the pool */
+  ~JobPool();
+
+  /**
+  * Joins a pool (and creates it if it does not exist)
+  * @param dir The directory of the pool
+  * @param size The number of slots in the pool
+  * @return Whether the pool could be joined
+  */
+  bool open(const String& dir, unsigned int size);
+
+  /**
+  * Takes a free slot without waiting for one
+  * @return Whether a slot was taken
+  */
+  bool acquire();
+
+  /** Frees a slot taken with acquire() */
+  void release();
+
+  /** Returns the number of slots that are held */
+  unsigned int getSlotCount() const {return (unsigned int)heldSlots.getSize();}
+
+  bool isOpen() const;
+
+private:
+#ifdef _WIN32
+  typedef void* Handle;
+#else
+  typedef int Handle;
+#endif
+
+  String dir;
+  Array<Handle> slots; /**< The opened lock files of the slots */
+  Array<unsigned int> heldSlots; /**< The indices of the slots that are held */
+  unsigned int nextSlot; /**< The slot that is tried first when looking for a free slot */
+  Handle instanceFile;
+  String instanceFileName;
+  unsigned int instanceCount; /**< The number of running instances when they were counted last */
+  long long instanceCountTime; /**< The time when the running instances were counted last */
+
+  unsigned int countInstances();
+
+  static bool openLockFile(const String& file, Handle& handle);
+  static bool lock(Handle handle);
+  static void unlock(Handle handle);
+  static void closeLockFile(Handle handle);
+};
@@ -0,0 +1,251 @@
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#endif
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Tools/Process.h"
+#include "Tools/Error.h"
+
+#include "JobServer.h"
+
+JobServer::JobServer() : active(false), ownFds(true)
+{
+#ifdef _WIN32
+  semaphore = 0;
+#else
+  readFd = writeFd = ownReadFd = -1;
+#endif
+}
+
+JobServer::~JobServer()
+{
+  while(!tokens.isEmpty())
+    release();
+  close();
+}
+
+void JobServer::start(unsigned int jobs, bool showDebug)
+{
+  // share the processors of the host with other mare instances
+  const Map<String, String>& envs = Process::getEnvironmentVariables();
+  const Map<String, String>::Node* node = envs.find("MARE_JOB_POOL");
+  if(node && node->data.getLength() > sizeof("MARE_JOB_POOL"))
+  {
+    String dir = node->data.substr(sizeof("MARE_JOB_POOL"));
+    if(pool.open(dir, Process::getProcessorCount() - 1)) // each instance runs a job without a slot
+    {
+      if(showDebug)
+        printf("debug: Using the job pool \"%s\"\n", dir.getData());
+    }
+    else if(showDebug)
+      printf("debug: Cannot use the job pool \"%s\": %s\n", dir.getData(), Error::getString().getData());
+  }
+
+  // use the jobserver of a parent make (--jobserver-fds is used by make versions prior to 4.2)
+  node = envs.find("MAKEFLAGS");
+  if(node)
+  {
+    const char* makeFlags = node->data.getData() + sizeof("MAKEFLAGS");
+    const char* auth = 0;
+    for(const char* i = makeFlags; (i = strstr(i, "--jobserver-")); ++i)
+      if(strncmp(i, "--jobserver-auth=", 17) == 0 || strncmp(i, "--jobserver-fds=", 16) == 0)
+        auth = strchr(i, '=') + 1; // the last one is valid
+    if(auth)
+    {
+      const char* end = auth;
+      while(*end && *end != ' ')
+        ++end;
+      String authString(auth, end - auth);
+      if(connect(authString))
+      {
+        active = true;
+        if(showDebug)
+          printf("debug: Using the jobserver \"%s\" of the parent make\n", authString.getData());
+        return;
+      }
+      if(showDebug)
+        printf("debug: Cannot use the jobserver \"%s\" of the parent make\n", authString.getData());
+    }
+  }
+
+  // provide a jobserver for child processes
+  if(jobs > 1)
+  {
+    if(create(jobs))
+      active = true;
+    else if(showDebug)
+      printf("debug: Cannot create a jobserver: %s\n", Error::getString().getData());
+  }
+}
+
+bool JobServer::acquireSlot(size_t runningJobs)
+{
+  if((tokens.getLength() < runningJobs && !acquire()) ||
+     (pool.getSlotCount() < runningJobs && pool.isOpen() && !pool.acquire()))
+  {
+    releaseSlots(runningJobs);
+    return false;
+  }
+  return true;
+}
+
+void JobServer::releaseSlots(size_t runningJobs)
+{
+  while(!tokens.isEmpty() && tokens.getLength() >= runningJobs)
+    release();
+  while(pool.getSlotCount() > 0 && pool.getSlotCount() >= runningJobs)
+    pool.release();
+}
+
+bool JobServer::acquire()
+{
+  if(!active)
+    return true;
+  char token;
+#ifdef _WIN32
+  if(WaitForSingleObject(semaphore, 0) != WAIT_OBJECT_0)
+    return false;
+  token = '+';
+#else
+  int fd = ownReadFd;
+  if(fd < 0)
+  {
+    // there is a small chance that another process takes the token after poll(), in which case read() waits for the next
+    // one (unless the jobserver is a non-blocking fifo)
+    pollfd pfd;
+    pfd.fd = readFd;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, 0) <= 0)
+      return false;
+    fd = readFd;
+  }
+  if(read(fd, &token, 1) != 1)
+    return false;
+#endif
+  tokens.append(token);
+  return true;
+}
+
+void JobServer::release()
+{
+  size_t count = tokens.getLength();
+  if(count == 0)
+    return;
+  char token = tokens.getData()[count - 1];
+  tokens.setLength(count - 1);
+#ifdef _WIN32
+  (void)token;
+  ReleaseSemaphore(semaphore, 1, 0);
+#else
+  while(write(writeFd, &token, 1) == -1 && errno == EINTR);
+#endif
+}
+
+bool JobServer::connect(const String& auth)
+{
+#ifdef _WIN32
+  semaphore = OpenSemaphore(SEMAPHORE_ALL_ACCESS, FALSE, auth.getData());
+  return semaphore != 0;
+#else
+  if(strncmp(auth.getData(), "fifo:", 5) == 0)
+  {
+    const char* path = auth.getData() + 5;
+    readFd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    writeFd = open(path, O_WRONLY | O_CLOEXEC);
+    if(readFd == -1 || writeFd == -1)
+    {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  // the pipe is only passed to commands that make considers recursive
+  char* end;
+  int fd = (int)strtol(auth.getData(), &end, 10);
+  if(*end != ',' || fcntl(fd, F_GETFD) == -1)
+    return false;
+  int fd2 = (int)strtol(end + 1, &end, 10);
+  if(*end || fcntl(fd2, F_GETFD) == -1)
+    return false;
+  readFd = fd;
+  writeFd = fd2;
+  ownFds = false;
+
+  // reading from a non-blocking file description of the pipe does not change the file description shared with make
+  char path[32];
+  sprintf(path, "/proc/self/fd/%d", readFd);
+  ownReadFd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  return true;
+#endif
+}
+
+bool JobServer::create(unsigned int jobs)
+{
+  String auth;
+#ifdef _WIN32
+  auth.format(64, "mare_jobserver_%u", (unsigned int)GetCurrentProcessId());
+  semaphore = CreateSemaphore(0, jobs - 1, jobs - 1, auth.getData());
+  if(!semaphore)
+    return false;
+#else
+  int fds[2];
+  if(pipe(fds) != 0)
+    return false;
+  readFd = fds[0];
+  writeFd = fds[1];
+  String initialTokens;
+  for(unsigned int i = 1; i < jobs; ++i)
+    initialTokens.append('+');
+  if(write(writeFd, initialTokens.getData(), initialTokens.getLength()) != (ssize_t)initialTokens.getLength())
+  {
+    close();
+    return false;
+  }
+  char path[32];
+  sprintf(path, "/proc/self/fd/%d", readFd);
+  ownReadFd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  auth.format(64, "%d,%d", readFd, writeFd);
+#endif
+
+  // announce the jobserver like make does
+  String makeFlags;
+  const Map<String, String>& envs = Process::getEnvironmentVariables();
+  const Map<String, String>::Node* node = envs.find("MAKEFLAGS");
+  if(node)
+    makeFlags = node->data.substr(sizeof("MAKEFLAGS"));
+  makeFlags.append(String().format(64, " -j%u --jobserver-auth=", jobs));
+  makeFlags.append(auth);
+  Process::setEnvironmentVariable("MAKEFLAGS", makeFlags);
+  return true;
+}
+
+void JobServer::close()
+{
+#ifdef _WIN32
+  if(semaphore)
+    CloseHandle(semaphore);
+  semaphore = 0;
+#else
+  if(ownReadFd != -1)
+    ::close(ownReadFd);
+  if(ownFds)
+  {
+    if(readFd != -1)
+      ::close(readFd);
+    if(writeFd != -1)
+      ::close(writeFd);
+  }
+  readFd = writeFd = ownReadFd = -1;
+  ownFds = true;
+#endif
+  active = false;
+}
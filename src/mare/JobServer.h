@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Tools/String.h"
+
+#include "JobPool.h"
+
+/**
+* A GNU make compatible jobserver that limits the number of processes run in parallel by mare and by the tools it
+* launches (e.g. make or "gcc -flto=jobserver"). Each process beyond the first one needs a token from the jobserver.
+* If mare is launched by make, the jobserver of make is used (as announced with --jobserver-auth in MAKEFLAGS).
+* Otherwise, mare provides a jobserver for its child processes. The jobs can also be limited by a JobPool that is shared
+* with the other mare instances of the host (see MARE_JOB_POOL).
+*/
+class JobServer
+{
+public:
+
+  JobServer();
+
+  /** Returns all tokens that are still held and closes the jobserver */
+  ~JobServer();
+
+  /**
+  * Connects to the jobserver of a parent make or creates a new jobserver and joins the job pool of the host if the
+  * environment variable MARE_JOB_POOL is set to the directory of the pool
+  * @param jobs The number of jobs shared with the child processes if a new jobserver is created
+  * @param showDebug Whether to print debug messages
+  */
+  void start(unsigned int jobs, bool showDebug);
+
+  /**
+  * Takes what is needed to start another job (the first job does not need a jobserver token)
+  * @param runningJobs The number of running jobs
+  * @return Whether the job can be started
+  */
+  bool acquireSlot(size_t runningJobs);
+
+  /**
+  * Returns the tokens and the slots of the job pool that are not needed for the running jobs
+  * @param runningJobs The number of running jobs
+  */
+  void releaseSlots(size_t runningJobs);
+
+private:
+  bool active;
+  bool ownFds; /**< Whether the jobserver has to be closed by mare (it is not the pipe of a parent make) */
+  String tokens; /**< The tokens that are held (they have to be returned unchanged) */
+#ifdef _WIN32
+  void* semaphore;
+#else
+  int readFd;
+  int writeFd;
+  int ownReadFd; /**< The non-blocking read end used by mare (or -1 if \c readFd is used with poll()) */
+#endif
+  JobPool pool;
+
+  /**
+  * Takes a token from the jobserver without waiting for one
+  * @return Whether a token was taken. This is always \c true if there is no jobserver.
+  */
+  bool acquire();
+
+  /** Returns a token taken with acquire() */
+  void release();
+
+  bool connect(const String& auth);
+  bool create(unsigned int jobs);
+  void close();
+};
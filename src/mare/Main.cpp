@@ -129,7 +129,14 @@ static void showUsage(const char* executable)
   puts("");
   puts("    -j <jobs>");
   puts("        Use <jobs> processes in parallel for building alle targets. The default");
-  puts("        value for <jobs> is the number of processors on the host system.");
+  puts("        value for <jobs> is the number of processors available to mare (which");
+  puts("        respects CPU affinity and container CPU quotas) but no more than one");
+  puts("        job per 512 MB of available memory.");
+  puts("        The jobs are shared with child processes that support the jobserver of");
+  puts("        GNU make (e.g. make or \"gcc -flto=jobserver\"). If mare is launched by");
+  puts("        make with a jobserver, it uses the jobs of make instead.");
+  puts("        Set the environment variable MARE_JOB_POOL to a directory to share the");
+  puts("        processors with other mare instances that use the same directory.");
   puts("");
   puts("    --ignore-dependencies");
   puts("        Do not respect dependencies between build targets.");
@@ -358,6 +365,16 @@ int main(int argc, char* argv[])
   // start the engine
   {
     Engine engine(errorHandler, argv[0]);
+
+    // direct build mode? (the Marefile is loaded by Mare unless there are cached rules from a previous run)
+    if(!showHelp && !generateMake && !generateVcxproj && !generateVcproj && !generateCodeLite && !generateCodeBlocks && !generateCMake && !generateNetBeans && !generateJsonDb)
+    {
+      Mare mare(engine, inputFile, inputPlatforms, inputConfigs, inputTargets, showDebug, clean, rebuild, jobs, ignoreDependencies);
+      if(!mare.build(userArgs))
+        return EXIT_FAILURE;
+      return EXIT_SUCCESS;
+    }
+
     if(!engine.load(inputFile))
     {
       if(showHelp)
@@ -454,12 +471,5 @@ int main(int argc, char* argv[])
       return EXIT_SUCCESS;
     }
 
-    // direct build
-    {
-      Mare mare(engine, inputPlatforms, inputConfigs, inputTargets, showDebug, clean, rebuild, jobs, ignoreDependencies);
-      if(!mare.build(userArgs))
-        return EXIT_FAILURE;
-      return EXIT_SUCCESS;
-    }
   }
 }
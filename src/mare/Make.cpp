@@ -10,6 +10,7 @@
 #include "Tools/Directory.h"
 
 #include "Make.h"
+#include "Builtin.h"
 
 bool Make::generate(const Map<String, String>& userArgs)
 {
@@ -679,6 +680,6 @@ String Make::joinCommands(const String& prefix, const String& suffix, const List
 {
   String result;
   for(const List<String>::Node* i = commands.getFirst(); i; i = i->getNext())
-    result += prefix + i->data + suffix;
+    result += prefix + Builtin::getShellCommand(i->data) + suffix;
   return result;
 }
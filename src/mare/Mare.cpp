@@ -1,252 +1,71 @@
 
 #include <cstdio>
+#include <cstdlib>
 #include <ctype.h>
+#include <cstring>
 
 #include "Mare.h"
+#include "Builtin.h"
+#include "ModuleDependencies.h"
+#include "JobServer.h"
 
 #include "Tools/Assert.h"
 #include "Tools/Process.h"
 #include "Tools/File.h"
 #include "Tools/Directory.h"
 #include "Tools/Error.h"
+#include "Tools/Word.h"
+#include "Tools/md5.h"
 #include "Engine.h"
 
-bool Mare::build(const Map<String, String>& userArgs)
-{
-  // add default rules and stuff
-  engine.addDefaultKey("cCompiler", "gcc");
-  engine.addDefaultKey("cppCompiler", "g++");
-  engine.addDefaultKey("configurations", "Debug Release");
-  engine.addDefaultKey("targets"); // an empty target list exists per default
-  engine.addDefaultKey("buildDir", "$(configuration)");
-  engine.addDefaultKey("outputDir", "$(buildDir)");
-  engine.addDefaultKey("cFlags", "-Wall $(if $(Debug),-g,-Os -fomit-frame-pointer)");
-  engine.addDefaultKey("cppFlags", "-Wall $(if $(Debug),-g,-Os -fomit-frame-pointer)");
-  engine.addDefaultKey("linkFlags", "$(if $(Debug),,-s)");
-  {
-    Map<String, String> cppApplication;
-    cppApplication.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(filter %.c%,$(files))))))");
-    cppApplication.append("output", "$(outputDir)/$(target)$(if $(Win32),.exe)");
-    cppApplication.append("command", "$(linker) -o $(output) $(input) $(linkFlags) $(LDFLAGS) $(patsubst %,-L%,$(libPaths)) $(patsubst %,-l%,$(libs))");
-    cppApplication.append("message", "-> $(output)");
-    cppApplication.append("linker", "$(if $(linker),$(linker),$(cppCompiler))");
-    engine.addDefaultKey("cppApplication", cppApplication);
-  }
-  {
-    Map<String, String> cppDynamicLibrary;
-    cppDynamicLibrary.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(filter %.c%,$(files))))))");
-    cppDynamicLibrary.append("output", "$(outputDir)/$(if $(Win32),,lib)$(patsubst lib%,%,$(target))$(if $(Win32),.dll,.so)");
-    cppDynamicLibrary.append("__soFlags", "$(if $(Win32),,-fpic)");
-    cppDynamicLibrary.append("command", "$(linker) -shared $(__soFlags) -o $(output) $(input) $(linkFlags) $(LDFLAGS) $(patsubst %,-L%,$(libPaths)) $(patsubst %,-l%,$(libs))");
-    cppDynamicLibrary.append("message", "-> $(output)");
-    cppDynamicLibrary.append("linker", "$(if $(linker),$(linker),$(cppCompiler))");
-    engine.addDefaultKey("cppDynamicLibrary", cppDynamicLibrary);
-  }
-  {
-    Map<String, String> cppStaticLibrary;
-    cppStaticLibrary.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(filter %.c%,$(files))))))");
-    cppStaticLibrary.append("output", "$(outputDir)/$(if $(Win32),,lib)$(patsubst lib%,%,$(target))$(if $(Win32),.lib,.a)");
-    cppStaticLibrary.append("command", "$(linker) rcs $(output) $(input)");
-    cppStaticLibrary.append("message", "-> $(output)");
-    cppStaticLibrary.append("linker", "$(if $(linker),$(linker),ar)");
-    engine.addDefaultKey("cppStaticLibrary", cppStaticLibrary);
-  }
-  {
-    Map<String, String> cApplication;
-    cApplication.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(filter %.c%,$(files))))))");
-    cApplication.append("output", "$(outputDir)/$(target)$(if $(Win32),.exe)");
-    cApplication.append("command", "$(linker) -o $(output) $(input) $(linkFlags) $(LDFLAGS) $(patsubst %,-L%,$(libPaths)) $(patsubst %,-l%,$(libs))");
-    cApplication.append("message", "-> $(output)");
-    cApplication.append("linker", "$(if $(linker),$(linker),$(cCompiler))");
-    engine.addDefaultKey("cApplication", cApplication);
-  }
-  {
-    Map<String, String> cDynamicLibrary;
-    cDynamicLibrary.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(filter %.c%,$(files))))))");
-    cDynamicLibrary.append("output", "$(outputDir)/$(if $(Win32),,lib)$(patsubst lib%,%,$(target))$(if $(Win32),.dll,.so)");
-    cDynamicLibrary.append("__soFlags", "$(if $(Win32),,-fpic)");
-    cDynamicLibrary.append("command", "$(linker) -shared $(__soFlags) -o $(output) $(input) $(linkFlags) $(LDFLAGS) $(patsubst %,-L%,$(libPaths)) $(patsubst %,-l%,$(libs))");
-    cDynamicLibrary.append("message", "-> $(output)");
-    cDynamicLibrary.append("linker", "$(if $(linker),$(linker),$(cCompiler))");
-    engine.addDefaultKey("cDynamicLibrary", cDynamicLibrary);
-  }
-  {
-    Map<String, String> cStaticLibrary;
-    cStaticLibrary.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(filter %.c%,$(files))))))");
-    cStaticLibrary.append("output", "$(outputDir)/$(if $(Win32),,lib)$(patsubst lib%,%,$(target))$(if $(Win32),.lib,.a)");
-    cStaticLibrary.append("command", "$(linker) rcs $(output) $(input)");
-    cStaticLibrary.append("message", "-> $(output)");
-    cStaticLibrary.append("linker", "$(if $(linker),$(linker),ar)");
-    engine.addDefaultKey("cStaticLibrary", cStaticLibrary);
-  }
-  {
-    Map<String, String> cppSource;
-    cppSource.append("__ofile", "$(buildDir)/$(basename $(subst ../,,$(file))).o");
-    cppSource.append("__dfile", "$(patsubst %.o,%.d,$(__ofile))");
-    cppSource.append("input", "$(file) $(filter-out %.o: \\,$(readfile $(__dfile)))");
-    cppSource.append("output", "$(__ofile) $(__dfile)");
-    cppSource.append("command", "$(cppCompiler) -MMD $(__soFlags) -o $(__ofile) -c $(file) $(cppFlags) $(CXXFLAGS) $(CPPFLAGS) $(LDFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths))");
-    cppSource.append("message", "$(subst ./,,$(file))");
-    engine.addDefaultKey("cppSource", cppSource);
-  }
-  {
-    Map<String, String> cSource;
-    cSource.append("__ofile", "$(buildDir)/$(basename $(subst ../,,$(file))).o");
-    cSource.append("__dfile", "$(patsubst %.o,%.d,$(__ofile))");
-    cSource.append("input", "$(file) $(filter-out %.o: \\,$(readfile $(__dfile)))");
-    cSource.append("output", "$(__ofile) $(__dfile)");
-    cSource.append("command", "$(cCompiler) -MMD $(__soFlags) -o $(__ofile) -c $(file) $(cFlags) $(CFLAGS) $(CPPFLAGS) $(LDFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths))");
-    cSource.append("message", "$(subst ./,,$(file))");
-    engine.addDefaultKey("cSource", cSource);
-  }
-#if defined(_WIN32) || defined(__CYGWIN__)
-  String platform("Win32");
-#elif defined(__linux)
-  String platform("Linux");
-#elif defined(__APPLE__) && defined(__MACH__)
-  String platform("MacOSX");
-#else
-  String platform("unknown");
-  // add your os :)
-  // http://predef.sourceforge.net/preos.html
-#endif
-  engine.addDefaultKey("host", platform); // the platform on which the compiler is run
-  engine.addDefaultKey("platforms", platform); // the target platform of the compiler
-
-  String architecture = Process::getArchitecture();
-  engine.addDefaultKey("architecture", architecture);
-  engine.addDefaultKey("arch", architecture);
-
-  // add user arguments
-  for(const Map<String, String>::Node* i = userArgs.getFirst(); i; i = i->getNext())
-    engine.addCommandLineKey(i->key, i->data);
-
-  // build 
-  if(!buildFile())
-    return false;
-
-  return true;
-}
-
-bool Mare::buildFile()
-{
-  // enter root key
-  engine.enterRootKey();
-
-  // read default or check input platform names
-  VERIFY(engine.enterKey("platforms"));
-  if(inputPlatforms.isEmpty())
-  {
-    String firstPlatform = engine.getFirstKey();
-    if(!firstPlatform.isEmpty())
-      inputPlatforms.append(firstPlatform);
-    else
-    {
-      engine.error("cannot find any platforms");
-      return false;
-    }
-  }
-  else
-    for(const List<String>::Node* i = inputPlatforms.getFirst(); i; i = i->getNext())
-      if(!engine.hasKey(i->data))
-      {
-        engine.error(String().format(256, "cannot find platform \"%s\"", i->data.getData()));
-        return false;
-      }
-  engine.leaveKey();
-
-  // read default or check input configuration names
-  VERIFY(engine.enterKey("configurations"));
-  if(inputConfigs.isEmpty())
-  {
-    String firstConfiguration = engine.getFirstKey();
-    if(!firstConfiguration.isEmpty())
-      inputConfigs.append(firstConfiguration);
-    else
-    {
-      engine.error("cannot find any configurations");
-      return false;
-    }
-  }
-  else
-    for(const List<String>::Node* i = inputConfigs.getFirst(); i; i = i->getNext())
-      if(!engine.hasKey(i->data))
-      {
-        engine.error(String().format(256, "cannot find configuration \"%s\"", i->data.getData()));
-        return false;
-      }
-  engine.leaveKey();
-
-  // read default or check input target names
-  VERIFY(engine.enterKey("targets"));
-  engine.getKeys(allTargets);
-  if(inputTargets.isEmpty())
-  {
-    if(!allTargets.isEmpty())
-      inputTargets.append(allTargets.getFirst()->data);
-    else
-    {
-      engine.error("cannot find any targets");
-      return false;
-    }
-  }
-  else
-    for(const List<String>::Node* i = inputTargets.getFirst(); i; i = i->getNext())
-      if(!engine.hasKey(i->data))
-      {
-        engine.error(String().format(256, "cannot find target \"%s\"", i->data.getData()));
-        return false;
-      }
-  engine.leaveKey();
-
-  // leave root key
-  engine.leaveKey(); 
-
-  // build input targets (with dependencies) foreach input configuration
-  for(const List<String>::Node* i = inputPlatforms.getFirst(); i; i = i->getNext())
-  {
-    const String& platform = i->data;
-    for(const List<String>::Node* i = inputConfigs.getFirst(); i; i = i->getNext())
-    {
-      const String& configuration = i->data;
-      if(!buildTargets(platform, configuration))
-        return false;
-    }
-  }
-
-  return true;
-}
-
 class Target;
+class RuleSet;
 
 class Rule
 {
 public:
-  const Mare* builder;
+  Mare* builder;
   Target* target;
 
   String name; /**< The main input file or the name of the target */
-  List<String> dependencies;
-  List<String> inputs;
-  List<String> outputs;
-  List<String> command;
-  List<String> message;
+  Array<String> dependencies;
+  Array<String> inputs;
+  Array<String> outputs;
+  Array<String> command;
+  Array<String> message;
+  String batchCommand; /**< A command that compiles the input files of several rules of a target at once (the names of the rules are appended) */
+  String batchDir; /**< The directory in which \c batchCommand is run (it should not depend on the current directory) */
+  Array<String> batchOutputs; /**< The files written to \c batchDir by \c batchCommand for this rule that are moved to \c outputs afterwards */
+  Array<String> unitySources; /**< The source files included by the generated unity translation unit \c name (the rule is defined by the key of the first one) */
+  String precompiledHeaderRule; /**< The key of the target that defines the rule if it compiles the precompiled header \c name (e.g. "cppPrecompiledHeader") */
+  String moduleScanFile; /**< The file to which \c moduleScanCommand writes the C++ modules provided and required by \c name (in the P1689 format) */
+  String moduleScanCommand; /**< The command that writes \c moduleScanFile (it is evaluated with the rule since it runs before any rule is applied) */
+  String moduleMapper; /**< The module mapper file that tells the compiler where to find the compiled module interfaces */
+  Array<String> moduleInputs; /**< The compiled module interfaces of the modules imported by \c name (see RuleSet::scanModules) */
+  Array<String> moduleOutputs; /**< The compiled module interfaces of the modules provided by \c name (see RuleSet::scanModules) */
+  bool evaluated; /**< Whether \c command, \c message and the batch command have been evaluated */
+  size_t dependencyInputs; /**< The number of output files of dependencies appended to \c inputs by RuleSet::resolveDependencies() */
   
-  unsigned int finishedRuleDependencies;
-  Map<Rule*, String> ruleDependencies;
-  Map<Rule*, String> rulePropagations;
+  unsigned int index; /**< The index of the rule in the rule graph of its RuleSet */
 
   bool rebuild;
-
-  const List<String>::Node* nextCommand;
-  Process process;
-
-  Rule() : finishedRuleDependencies(0), rebuild(false) {}
-
-  bool startExecution(unsigned int& pid)
+  bool upToDate;
+  bool batched; /**< Whether the rule has to be applied and waits for being applied together with other rules */
+
+  size_t nextCommand; /**< The index of the next command to be executed */
+  Rule* nextInBatch; /**< The next rule of a batch that is applied with the command of its first rule */
+
+  Rule() : evaluated(false), dependencyInputs(0), index(0), rebuild(false), upToDate(false), batched(false), nextInBatch(0) {}
+
+  /**
+  * Starts applying the rule if it has to be applied
+  * @param rebuiltInput An input file that was built by a rule that has been applied or \c 0
+  * @param process The process used for running the commands of the rule
+  * @param pid The process id of the started command or \c 0 if no command has been started
+  * @return Whether everything went well
+  */
+  bool startExecution(const String* rebuiltInput, Process& process, unsigned int& pid)
   {
-    ASSERT(finishedRuleDependencies == ruleDependencies.getSize());
-
     if(builder->clean)
       goto clean;
     if(builder->rebuild)
@@ -259,93 +78,68 @@ public:
     // determine whether to build this rule
     
     // Command-only rules
-    if (outputs.isEmpty() && inputs.isEmpty() && !(command.isEmpty()))
+    if (outputs.isEmpty() && inputs.isEmpty())
     {
-	  goto run;
-	}
+      if(!evaluated && !builder->evaluateCommands(*this))
+        return false;
+      if(!command.isEmpty())
+        goto run;
+    }
     
-    for(Map<Rule*, String>::Node* i = ruleDependencies.getFirst(); i; i = i->getNext())
-      if(i->key->rebuild)
-      {
-        if(builder->showDebug)
-          printf("debug: Applying rule for \"%s\" since the rule for the input file \"%s\" was applied as well\n", name.getData(), i->data.getData());
-        goto build;
-      }
+    if(rebuiltInput)
+    {
+      if(builder->showDebug)
+        printf("debug: Applying rule for \"%s\" since the rule for the input file \"%s\" was applied as well\n", name.getData(), rebuiltInput->getData());
+      goto build;
+    }
     if(!outputs.isEmpty())
     {
       long long minWriteTime = 0;
       String minOutputFile;
-      for(const List<String>::Node* i = outputs.getFirst(); i; i = i->getNext())
-      {
-        const String& file = i->data;
-        long long writeTime;
-        if(!File::getWriteTime(file, writeTime))
-        {
-          if(builder->showDebug)
-          {
-            if(!File::exists(file))
-              printf("debug: Applying rule for \"%s\" since the output file \"%s\" does not exist\n", name.getData(), file.getData());
-            else
-              printf("debug: Applying rule for \"%s\" since the last modification time of output file \"%s\" cannot be read\n", name.getData(), file.getData());
-          }
-          goto build;
-        }
-        if(i == outputs.getFirst() || writeTime < minWriteTime)
-        {
-          minWriteTime = writeTime;
-          minOutputFile = file;
-        }
-      }
-      for(const List<String>::Node* i = inputs.getFirst(); i; i = i->getNext())
-      {
-        const String& file = i->data;
-        long long writeTime;
-        if(!File::getWriteTime(file, writeTime))
-        {
-          if(builder->showDebug)
-          {
-            if(!File::exists(file))
-              printf("debug: Applying rule for \"%s\" since the input file \"%s\" does not exist\n", name.getData(), file.getData());
-            else
-              printf("debug: Applying rule for \"%s\" since the last modification time of input file \"%s\" cannot be read\n", name.getData(), file.getData());
-          }
-          goto build;
-        }
-        if(writeTime > minWriteTime) // Do not rebuild if both files have the same write time. This will prevent mare from (e.g.) relinking output files on systems (e.g. windows)
-                                     // with a timestamp resolutions of a second when compiling and linking can be done in less than a second.
-        {
-          if(builder->showDebug)
-            printf("debug: Applying rule for \"%s\" since the input file \"%s\" is newer than output file \"%s\"\n", name.getData(), file.getData(), minOutputFile.getData());
-          goto build;
-        }
-      }
+      if(!checkOutputs(outputs, minWriteTime, minOutputFile) || !checkOutputs(moduleOutputs, minWriteTime, minOutputFile) ||
+         !checkInputs(inputs, minWriteTime, minOutputFile) || !checkInputs(moduleInputs, minWriteTime, minOutputFile))
+        goto build;
     }
 
     // no rebuilding
+    upToDate = true;
     pid = 0;
     return true;
   
 clean:
 
     // delete output files and directories
-    for(const List<String>::Node* i = outputs.getFirst(); i; i = i->getNext())
+    if(!moduleScanFile.isEmpty() && !builder->rebuild)
+      File::unlink(moduleScanFile);
+    for(const String* i = outputs.getFirst(), * end = outputs.getEnd(); i < end; ++i)
     {
-      if(File::exists(i->data))
+      if(File::exists(*i))
       {
-        if(!File::unlink(i->data))
+        if(!File::unlink(*i))
           builder->engine.error(Error::getString());
       }
       if(!builder->rebuild)
       {
         /*
-        String dir = File::getDirname(i->data);
+        String dir = File::getDirname(*i);
         if(!unlinkDirs.find(dir)
           unlinkDirs.append(dir, 0);
         */
-        Directory::remove(File::getDirname(i->data));
+        Directory::remove(File::getDirname(*i));
       }
     }
 
+    for(const String* i = moduleOutputs.getFirst(), * end = moduleOutputs.getEnd(); i < end; ++i)
+    {
+      if(File::exists(*i) && !File::unlink(*i))
+        builder->engine.error(Error::getString());
+      if(!builder->rebuild)
+        Directory::remove(File::getDirname(*i));
+    }
+
+    if(!builder->rebuild && !batchDir.isEmpty())
+      Directory::remove(batchDir);
+
     if(builder->rebuild)
       goto build;
     pid = 0;
@@ -361,66 +155,247 @@ clean:
       return true; // that was easy
     }
 
-    if(!message.isEmpty())
+    if(!evaluated && !builder->evaluateCommands(*this))
+      return false;
+
+    if(!batchCommand.isEmpty())
     {
-      for(const List<String>::Node* i = message.getFirst(); i; i = i->getNext())
-        puts(i->data.getData());
-      fflush(stdout);
+      batched = true; // the rule set decides how to apply the rule (see RuleSet::startBatches)
+      pid = 0;
+      return true;
     }
 
-    // create output directories
-    for(const List<String>::Node* i = outputs.getFirst(); i; i = i->getNext())
-      Directory::create(File::getDirname(i->data));
+    beginExecution();
     
     run:
 
-    nextCommand = command.getFirst();
-    return continueExecution(pid);
+    nextCommand = 0;
+    return continueExecution(process, pid);
   }
 
-  bool continueExecution(unsigned int& pid)
+  /**
+  * Checks whether output files exist and determines the oldest one
+  * @param files The output files
+  * @param minWriteTime The modification time of the oldest output file
+  * @param minOutputFile The oldest output file
+  * @return \c false if the rule has to be applied
+  */
+  bool checkOutputs(const Array<String>& files, long long& minWriteTime, String& minOutputFile)
   {
-    if(process.isRunning())
+    for(const String* i = files.getFirst(), * end = files.getEnd(); i < end; ++i)
     {
-      unsigned int exitCode = process.join();
-      if(exitCode != 0)
+      const String& file = *i;
+      long long writeTime;
+      if(!File::getWriteTime(file, writeTime))
       {
-        pid = 0;
+        if(builder->showDebug)
+        {
+          if(!File::exists(file))
+            printf("debug: Applying rule for \"%s\" since the output file \"%s\" does not exist\n", name.getData(), file.getData());
+          else
+            printf("debug: Applying rule for \"%s\" since the last modification time of output file \"%s\" cannot be read\n", name.getData(), file.getData());
+        }
         return false;
       }
+      if(minOutputFile.isEmpty() || writeTime < minWriteTime)
+      {
+        minWriteTime = writeTime;
+        minOutputFile = file;
+      }
     }
+    return true;
+  }
 
-    String singleCommand;
-    while(nextCommand)
+  /**
+  * Checks whether input files exist and are not newer than the oldest output file
+  * @return \c false if the rule has to be applied
+  */
+  bool checkInputs(const Array<String>& files, long long minWriteTime, const String& minOutputFile)
+  {
+    for(const String* i = files.getFirst(), * end = files.getEnd(); i < end; ++i)
     {
-      singleCommand = nextCommand->data;
-      nextCommand = nextCommand->getNext();
-      if(!singleCommand.isEmpty())
-        break;
+      const String& file = *i;
+      long long writeTime;
+      if(!File::getWriteTime(file, writeTime))
+      {
+        if(builder->showDebug)
+        {
+          if(!File::exists(file))
+            printf("debug: Applying rule for \"%s\" since the input file \"%s\" does not exist\n", name.getData(), file.getData());
+          else
+            printf("debug: Applying rule for \"%s\" since the last modification time of input file \"%s\" cannot be read\n", name.getData(), file.getData());
+        }
+        return false;
+      }
+      if(writeTime > minWriteTime) // Do not rebuild if both files have the same write time. This will prevent mare from (e.g.) relinking output files on systems (e.g. windows)
+                                   // with a timestamp resolutions of a second when compiling and linking can be done in less than a second.
+      {
+        if(builder->showDebug)
+          printf("debug: Applying rule for \"%s\" since the input file \"%s\" is newer than output file \"%s\"\n", name.getData(), file.getData(), minOutputFile.getData());
+        return false;
+      }
     }
-
-    if(singleCommand.isEmpty())
+    return true;
+  }
+
+  /** Prints the message of the rule and creates the directories of its output files */
+  void beginExecution()
+  {
+    if(!message.isEmpty())
     {
-      pid = 0;
-      return true;
+      for(const String* i = message.getFirst(), * end = message.getEnd(); i < end; ++i)
+        puts(i->getData());
+      fflush(stdout);
+    }
+
+    // create output directories
+    for(const String* i = outputs.getFirst(), * end = outputs.getEnd(); i < end; ++i)
+      Directory::create(File::getDirname(*i));
+  }
+
+  /**
+  * Starts applying this rule and the rules chained with \c nextInBatch using a single command
+  * @param process The process used for running the command
+  * @param pid The process id of the started command
+  * @return Whether everything went well
+  */
+  bool startBatch(Process& process, unsigned int& pid)
+  {
+    String batch = batchCommand;
+    String currentDir = Directory::getCurrent() + "/";
+    for(Rule* rule = this; rule; rule = rule->nextInBatch)
+    {
+      rule->batched = false;
+      rule->beginExecution();
+      String name = File::isPathAbsolute(rule->name) ? rule->name : currentDir + rule->name; // the command is run in the batch directory
+      batch.append(' ');
+      if(strpbrk(name.getData(), " \t"))
+      {
+        batch.append('"');
+        batch.append(name);
+        batch.append('"');
+      }
+      else
+        batch.append(name);
     }
 
     if(message.isEmpty())
     {
-      puts(singleCommand.getData());
+      puts(batch.getData());
       fflush(stdout);
     }
 
     if(builder->showDebug)
     {
-      printf("debug: %s\n", singleCommand.getData());
+      printf("debug: %s\n", batch.getData());
       fflush(stdout);
     }
 
+    if(!Directory::create(batchDir))
+    {
+      builder->engine.error(String().format(256 + batchDir.getLength(), "cannot create directory \"%s\"", batchDir.getData()));
+      return false;
+    }
+    pid = process.start(batch, batchDir);
+    if(!pid)
+    {
+      String error = Error::getString();
+      String text = Process::getProgram(batch);
+      text.append(": ");
+      text.append(error);
+      builder->engine.error(text);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+  * Finishes applying a batch of rules started with startBatch() by moving the files written by the batch command to the output files of the rules
+  * @param process The process used for running the command
+  * @return Whether everything went well
+  */
+  bool finishBatch(Process& process)
+  {
+    if(process.join() != 0)
+    {
+      for(Rule* rule = this; rule; rule = rule->nextInBatch)
+        for(const String* i = rule->batchOutputs.getFirst(), * end = rule->batchOutputs.getEnd(); i < end; ++i)
+          File::unlink(*i);
+      return false;
+    }
+    for(Rule* rule = this; rule; rule = rule->nextInBatch)
+      for(const String* i = rule->batchOutputs.getFirst(), * end = rule->batchOutputs.getEnd(), * output = rule->outputs.getFirst(), * outputEnd = rule->outputs.getEnd(); i < end && output < outputEnd; ++i, ++output)
+        if(!File::rename(*i, *output))
+        {
+          String error = Error::getString();
+          builder->engine.error(String().format(256 + i->getLength(), "cannot move \"%s\": %s", i->getData(), error.getData()));
+          return false;
+        }
+    return true;
+  }
+
+  bool continueExecution(Process& process, unsigned int& pid)
+  {
+    if(process.isRunning())
+    {
+      unsigned int exitCode = process.join();
+      if(exitCode != 0)
+      {
+        pid = 0;
+        return false;
+      }
+    }
+
+    String singleCommand;
+    for(;;)
+    {
+      singleCommand.clear();
+      while(nextCommand < command.getSize())
+      {
+        singleCommand = command[nextCommand++];
+        if(!singleCommand.isEmpty())
+          break;
+      }
+
+      if(singleCommand.isEmpty())
+      {
+        pid = 0;
+        return true;
+      }
+
+      if(message.isEmpty())
+      {
+        puts(singleCommand.getData());
+        fflush(stdout);
+      }
+
+      if(builder->showDebug)
+      {
+        printf("debug: %s\n", singleCommand.getData());
+        fflush(stdout);
+      }
+
+      if(!Builtin::isBuiltin(singleCommand))
+        break;
+
+      // execute built-in commands without starting a process
+      String error;
+      if(!Builtin::execute(singleCommand, error))
+      {
+        builder->engine.error(error);
+        pid = 0;
+        return false;
+      }
+    }
+
     pid = process.start(singleCommand);
     if(!pid)
     {
-      builder->engine.error(Error::getString());
+      String error = Error::getString();
+      String text = Process::getProgram(singleCommand);
+      text.append(": ");
+      text.append(error);
+      builder->engine.error(text);
       return false;
     }
     return true;
@@ -433,15 +408,30 @@ public:
   List<Rule> rules;
   bool active;
   Rule* rule; /**< The final rule for the target (mostly used for linking) */
+  RuleSet* ruleSet;
 
-  Target() : active(false) {}
+  Target() : active(false), rule(0), ruleSet(0) {}
+};
+
+/** Source files of a target that are compiled together in unity translation units */
+class UnityGroup
+{
+public:
+  String unityFile; /**< The name of the unity translation units (with "%" for the number of a unit) */
+  int size; /**< The number of source files in a unity translation unit */
+  Array<String> sources;
+
+  UnityGroup() : size(0) {}
 };
 
 class RuleSet
 {
 public:
+  String platform;
+  String configuration;
   Map<String, Target> targets;
   List<Target*> activeTargets;
+  Map<String, void*> precompiledHeaders; /**< The precompiled header files for which a rule has been added (rules are shared by targets that compile a header with the same flags) */
 
   unsigned int activeRules;
   unsigned int finishedRules;
@@ -450,28 +440,39 @@ public:
 
   void resolveDependencies(bool activateDependencies)
   {
-    // generate outputToRule map
+    // number the rules and generate outputToRule map
     Map<String, Rule*> outputToRule;
+    rules.clear();
     for(Map<String, Target>::Node* i = targets.getFirst(); i; i = i->getNext())
       for(List<Rule>::Node* j = i->data.rules.getFirst(); j; j = j->getNext())
       {
         Rule& rule = j->data;
-        if(rule.command.isEmpty() && !rule.outputs.isEmpty())
+        rule.index = (unsigned int)rules.getSize();
+        rules.append(&rule);
+        if(rule.evaluated && rule.command.isEmpty() && !rule.outputs.isEmpty())
         {
           printf("warning: Rule for \"%s\" does not define a command\n", rule.name.getData());
         }
-        for(List<String>::Node* i = rule.outputs.getFirst(); i; i = i->getNext())
+        for(String* i = rule.outputs.getFirst(), * end = rule.outputs.getEnd(); i < end; ++i)
         {
-          if(outputToRule.find(i->data))
+          if(outputToRule.find(*i))
           {
-            printf("warning: There are multiple rules for the output file \"%s\"\n", i->data.getData());
+            printf("warning: There are multiple rules for the output file \"%s\"\n", i->getData());
             continue;
           }
-          outputToRule.append(i->data, &rule);
+          outputToRule.append(*i, &rule);
         }
+        for(String* i = rule.moduleOutputs.getFirst(), * end = rule.moduleOutputs.getEnd(); i < end; ++i)
+          if(!outputToRule.find(*i))
+            outputToRule.append(*i, &rule);
       }
 
     // map input files to rules
+    Array<Edge> edges;
+    Array<unsigned int> lastDependent; // for finding duplicate edges
+    lastDependent.setSize(rules.getSize());
+    for(unsigned int* i = lastDependent.getFirst(), * end = lastDependent.getEnd(); i < end; ++i)
+      *i = (unsigned int)-1;
     for(List<Target*>::Node* i = activeTargets.getFirst(); i; i = i->getNext())
       for(List<Rule>::Node* j = i->data->rules.getFirst(); j; j = j->getNext())
       {
@@ -479,16 +480,17 @@ public:
         ++activeRules;
 
         // convert "dependencies" to additional input files
-        for(List<String>::Node* i = rule.dependencies.getFirst(); i; i = i->getNext())
+        for(String* i = rule.dependencies.getFirst(), * end = rule.dependencies.getEnd(); i < end; ++i)
         {
-          Map<String, Target>::Node* node = targets.find(i->data);
+          Map<String, Target>::Node* node = targets.find(*i);
           if(!node)
           {
-            printf("warning: Cannot resolve dependency \"%s\" for the rule for \"%s\"\n", i->data.getData(), rule.name.getData());
+            printf("warning: Cannot resolve dependency \"%s\" for the rule for \"%s\"\n", i->getData(), rule.name.getData());
             continue;
           }
-          for(List<String>::Node* j = node->data.rule->outputs.getFirst(); j; j = j->getNext())
-            rule.inputs.append(j->data);
+          for(const String* j = node->data.rule->outputs.getFirst(), * end = node->data.rule->outputs.getEnd(); j < end; ++j)
+            rule.inputs.append(*j);
+          rule.dependencyInputs += node->data.rule->outputs.getSize();
 
           // activate dependency
           if(activateDependencies && !node->data.active)
@@ -498,10 +500,12 @@ public:
           }
         }
 
-        //
-        for(List<String>::Node* i = rule.inputs.getFirst(); i; i = i->getNext())
+        // the compiled module interfaces imported by the rule are numbered after its input files
+        size_t inputCount = rule.inputs.getSize();
+        for(size_t k = 0, count = inputCount + rule.moduleInputs.getSize(); k < count; ++k)
         {
-          Rule* dependency = outputToRule.lookup(i->data);
+          const String* i = k < inputCount ? &rule.inputs[k] : &rule.moduleInputs[k - inputCount];
+          Rule* dependency = outputToRule.lookup(*i);
           if(dependency)
           {
             if(dependency == &rule)
@@ -521,82 +525,409 @@ public:
             }
 
             //
-            if(!rule.ruleDependencies.find(dependency))
-              rule.ruleDependencies.append(dependency, i->data);
-            if(!dependency->rulePropagations.find(&rule))
-              dependency->rulePropagations.append(&rule, i->data);
+            if(lastDependent[dependency->index] != rule.index)
+            {
+              lastDependent[dependency->index] = rule.index;
+              Edge& edge = edges.append();
+              edge.rule = rule.index;
+              edge.dependency = dependency->index;
+              edge.input = (unsigned int)k;
+            }
           }
         }
       }
+
+    // store the edges in compressed rows (sorted by rule for the dependencies and by dependency for the propagations)
+    size_t ruleCount = rules.getSize();
+    dependencyOffsets.setSize(ruleCount + 1);
+    propagationOffsets.setSize(ruleCount + 1);
+    for(size_t i = 0; i <= ruleCount; ++i)
+      dependencyOffsets[i] = propagationOffsets[i] = 0;
+    for(const Edge* i = edges.getFirst(), * end = edges.getEnd(); i < end; ++i)
+    {
+      ++dependencyOffsets[i->rule + 1];
+      ++propagationOffsets[i->dependency + 1];
+    }
+    for(size_t i = 0; i < ruleCount; ++i)
+    {
+      dependencyOffsets[i + 1] += dependencyOffsets[i];
+      propagationOffsets[i + 1] += propagationOffsets[i];
+    }
+    dependencies.setSize(edges.getSize());
+    propagations.setSize(edges.getSize());
+    {
+      Array<unsigned int> dependencyEnds(dependencyOffsets);
+      Array<unsigned int> propagationEnds(propagationOffsets);
+      for(const Edge* i = edges.getFirst(), * end = edges.getEnd(); i < end; ++i)
+      {
+        Dependency& dependency = dependencies[dependencyEnds[i->rule]++];
+        dependency.rule = i->dependency;
+        dependency.input = i->input;
+        propagations[propagationEnds[i->dependency]++] = i->rule;
+      }
+    }
   }
   
-  bool build(Engine& engine, unsigned int maxParallelJobs, bool clean, bool rebuild, bool showDebug)
+  /**
+  * Runs the module scan commands of rules that use C++ modules (unless their scan files are up to date) and determines the
+  * compiled module interfaces that are written and imported by the rules. The module mapper files of the rules are updated
+  * accordingly. This has to be done before resolveDependencies() since the imports of a rule determine its dependencies.
+  * @return Whether everything went well
+  */
+  bool scanModules(Engine& engine, JobServer& jobServer, unsigned int maxParallelJobs, bool clean, bool rebuild, bool showDebug)
+  {
+    // run the scan commands of rules with outdated scan files
+    Array<Rule*> scannedRules;
+    {
+      List<Rule*> pendingScans;
+      for(Map<String, Target>::Node* i = targets.getFirst(); i; i = i->getNext())
+        for(List<Rule>::Node* j = i->data.rules.getFirst(); j; j = j->getNext())
+        {
+          Rule& rule = j->data;
+          if(rule.moduleScanFile.isEmpty())
+            continue;
+          scannedRules.append(&rule);
+          if(clean && !rebuild)
+            continue;
+          if(!rebuild && !isScanOutdated(rule, showDebug))
+            continue;
+          if(rule.moduleScanCommand.isEmpty())
+          {
+            engine.error(String().format(256 + rule.name.getLength(), "rule for \"%s\" does not define a module scan command", rule.name.getData()));
+            return false;
+          }
+          pendingScans.append(&rule);
+        }
+      if(scannedRules.isEmpty())
+        return true;
+
+      Map<unsigned int, Process*> runningScans;
+      List<Process> processes;
+      List<Process*> idleProcesses;
+      bool failure = false;
+      while(!runningScans.isEmpty() || (!pendingScans.isEmpty() && !failure))
+      {
+        jobServer.releaseSlots(runningScans.getSize());
+        while(!failure && runningScans.getSize() < maxParallelJobs && !pendingScans.isEmpty())
+        {
+          if(!jobServer.acquireSlot(runningScans.getSize()))
+            break;
+          Rule& rule = *pendingScans.getFirst()->data;
+          pendingScans.removeFirst();
+          Process* process;
+          if(idleProcesses.isEmpty())
+            process = &processes.append();
+          else
+          {
+            process = idleProcesses.getFirst()->data;
+            idleProcesses.removeFirst();
+          }
+          if(showDebug)
+          {
+            printf("debug: %s\n", rule.moduleScanCommand.getData());
+            fflush(stdout);
+          }
+          Directory::create(File::getDirname(rule.moduleScanFile));
+          unsigned int pid = process->start(rule.moduleScanCommand);
+          if(!pid)
+          {
+            String error = Error::getString();
+            String text = Process::getProgram(rule.moduleScanCommand);
+            text.append(": ");
+            text.append(error);
+            engine.error(text);
+            idleProcesses.append(process);
+            failure = true;
+            break;
+          }
+          runningScans.append(pid, process);
+        }
+        if(runningScans.isEmpty())
+          break;
+        unsigned int pid = Process::waitOne();
+        Map<unsigned int, Process*>::Node* node = runningScans.find(pid);
+        if(!node)
+          continue;
+        Process* process = node->data;
+        runningScans.remove(node);
+        if(process->join() != 0)
+          failure = true;
+        idleProcesses.append(process);
+      }
+      if(failure)
+        return false;
+    }
+
+    // map the provided modules to their compiled module interfaces
+    Array<ModuleDependencies> scans;
+    scans.setSize(scannedRules.getSize());
+    Map<String, String> moduleInterfaces;
+    for(size_t i = 0; i < scannedRules.getSize(); ++i)
+    {
+      Rule& rule = *scannedRules[i];
+      rule.moduleInputs.clear();
+      rule.moduleOutputs.clear();
+      if(!scans[i].read(rule.moduleScanFile))
+      {
+        if(clean && !rebuild)
+          continue;
+        engine.error(String().format(256 + rule.moduleScanFile.getLength(), "cannot read module scan file \"%s\"", rule.moduleScanFile.getData()));
+        return false;
+      }
+      for(const String* j = scans[i].providedModules.getFirst(), * end = scans[i].providedModules.getEnd(); j < end; ++j)
+      {
+        if(moduleInterfaces.find(*j))
+        {
+          printf("warning: There are multiple rules for the module \"%s\"\n", j->getData());
+          continue;
+        }
+        String file = File::getDirname(rule.moduleMapper);
+        file.append('/');
+        for(const char* k = j->getData(); *k; ++k)
+          file.append(*k == ':' ? '-' : *k); // module partitions
+        file.append(".gcm");
+        moduleInterfaces.append(*j, file);
+        rule.moduleOutputs.append(file);
+      }
+    }
+    for(size_t i = 0; i < scannedRules.getSize(); ++i)
+    {
+      Rule& rule = *scannedRules[i];
+      for(const String* j = scans[i].requiredModules.getFirst(), * end = scans[i].requiredModules.getEnd(); j < end; ++j)
+      {
+        const Map<String, String>::Node* node = moduleInterfaces.find(*j);
+        if(node)
+          rule.moduleInputs.append(node->data);
+        // other modules (e.g. "std") are left to the compiler
+      }
+    }
+
+    // write the module mapper files (each of them knows all modules of the rule set)
+    String mapper;
+    for(const Map<String, String>::Node* i = moduleInterfaces.getFirst(); i; i = i->getNext())
+    {
+      mapper.append(i->key);
+      mapper.append(' ');
+      mapper.append(i->data);
+      mapper.append('\n');
+    }
+    Map<String, void*> mapperFiles;
+    for(const Rule* const* i = scannedRules.getFirst(), * const* end = scannedRules.getEnd(); i < end; ++i)
+    {
+      const String& file = (*i)->moduleMapper;
+      if(file.isEmpty() || mapperFiles.find(file))
+        continue;
+      mapperFiles.append(file, 0);
+      if(clean)
+      {
+        File::unlink(file);
+        Directory::remove(File::getDirname(file));
+      }
+      else if(!writeModuleMapper(file, mapper))
+      {
+        engine.error(String().format(256 + file.getLength(), "cannot write module mapper \"%s\": %s", file.getData(), Error::getString().getData()));
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool build(Engine& engine, JobServer& jobServer, unsigned int maxParallelJobs, bool clean, bool rebuild, bool showDebug)
   {
+    Array<unsigned int> finishedDependencies;
+    finishedDependencies.setSize(rules.getSize());
+    for(unsigned int* i = finishedDependencies.getFirst(), * end = finishedDependencies.getEnd(); i < end; ++i)
+      *i = 0;
+
     List<Rule*> pendingJobs;
     for(List<Target*>::Node* i = activeTargets.getFirst(); i; i = i->getNext())
       for(List<Rule>::Node* j = i->data->rules.getFirst(); j; j = j->getNext())
-        if(j->data.ruleDependencies.isEmpty())
+        if(dependencyOffsets[j->data.index + 1] == dependencyOffsets[j->data.index])
           pendingJobs.append(&j->data);
     
-    Map<unsigned int, Rule*> runningJobs;
+    Map<unsigned int, Job> runningJobs;
+    List<Process> processes; // processes are only needed for running jobs
+    List<Process*> idleProcesses;
+    List<Rule*> batchedRules; // rules that have to be applied with a batch command
+    Map<String, Rule*> usedBatchOutputs; // the files written by running batch commands
     bool failure = false;
     do
     {
       Rule* rule;
+      Process* process;
 
+      jobServer.releaseSlots(runningJobs.getSize());
       if(!failure)
+      {
         while(runningJobs.getSize() < maxParallelJobs && !pendingJobs.isEmpty())
         {
+          if(!jobServer.acquireSlot(runningJobs.getSize()))
+            break;
           rule = pendingJobs.getFirst()->data;
           pendingJobs.removeFirst();
+          if(idleProcesses.isEmpty())
+            process = &processes.append();
+          else
+          {
+            process = idleProcesses.getFirst()->data;
+            idleProcesses.removeFirst();
+          }
+          unsigned int pid;
+          if(!rule->startExecution(getRebuiltInput(*rule), *process, pid))
+          {
+            failure = true;
+            idleProcesses.append(process);
+            goto finishedRuleExecution;
+          }
+          if(pid)
+            runningJobs.append(pid, Job(rule, process, false));
+          else
+          {
+            idleProcesses.append(process);
+            if(rule->batched)
+            {
+              batchedRules.append(rule);
+              continue;
+            }
+            goto finishedRuleExecution;
+          }
+        }
+
+        // split the rules that wait for a batch command into batches for the free job slots
+        if(runningJobs.getSize() < maxParallelJobs && !batchedRules.isEmpty() && jobServer.acquireSlot(runningJobs.getSize()))
+        {
+          // the size of a batch is limited, so that a single compiler process does not get too much work and the command line does not get too long
+          static const size_t maxBatchSize = 32;
+#ifdef _WIN32
+          static const size_t maxBatchCommandLength = 32000; // CreateProcess() accepts 32767 characters
+#else
+          static const size_t maxBatchCommandLength = 128 * 1024; // ARG_MAX is larger on all supported platforms
+#endif
+          size_t freeSlots = maxParallelJobs - runningJobs.getSize();
+          size_t batchSize = (batchedRules.getSize() + freeSlots - 1) / freeSlots;
+          if(batchSize > maxBatchSize)
+            batchSize = maxBatchSize;
+          rule = batchedRules.getFirst()->data;
+          batchedRules.removeFirst();
+          rule->nextInBatch = 0;
+          size_t size = 1;
+          if(batchSize > 1 && useBatchOutputs(*rule, usedBatchOutputs))
+          {
+            // startBatch() appends the absolute and maybe quoted names of the rules
+            size_t currentDirLength = Directory::getCurrent().getLength() + 1;
+            size_t commandLength = rule->batchCommand.getLength() + 3 + currentDirLength + rule->name.getLength();
+            Rule* last = rule;
+            for(List<Rule*>::Node* i = batchedRules.getFirst(), * next; i && size < batchSize; i = next)
+            {
+              next = i->getNext();
+              Rule* candidate = i->data;
+              if(candidate->target != rule->target || candidate->batchCommand != rule->batchCommand || candidate->batchDir != rule->batchDir)
+                continue;
+              size_t nameLength = 3 + currentDirLength + candidate->name.getLength();
+              if(commandLength + nameLength > maxBatchCommandLength)
+                break;
+              if(!useBatchOutputs(*candidate, usedBatchOutputs))
+                continue;
+              commandLength += nameLength;
+              candidate->nextInBatch = 0;
+              last->nextInBatch = candidate;
+              last = candidate;
+              batchedRules.remove(i);
+              ++size;
+            }
+            if(size == 1)
+              releaseBatchOutputs(*rule, usedBatchOutputs);
+          }
+
+          if(idleProcesses.isEmpty())
+            process = &processes.append();
+          else
+          {
+            process = idleProcesses.getFirst()->data;
+            idleProcesses.removeFirst();
+          }
           unsigned int pid;
-          if(!rule->startExecution(pid))
+          bool success;
+          if(size == 1) // a single rule is applied with its usual command
+          {
+            rule->batched = false;
+            rule->beginExecution();
+            rule->nextCommand = 0;
+            success = rule->continueExecution(*process, pid);
+          }
+          else
+            success = rule->startBatch(*process, pid);
+          if(!success)
           {
             failure = true;
+            idleProcesses.append(process);
             goto finishedRuleExecution;
           }
           if(pid)
-            runningJobs.append(pid, rule);
+            runningJobs.append(pid, Job(rule, process, size > 1));
           else
+          {
+            idleProcesses.append(process);
             goto finishedRuleExecution;
+          }
+          continue;
         }
+      }
 
       if(!runningJobs.isEmpty())
       {
         unsigned int pid = Process::waitOne();
-        Map<unsigned int, Rule*>::Node* job = runningJobs.find(pid);
+        Map<unsigned int, Job>::Node* job = runningJobs.find(pid);
         if(!job)
           continue;
-        rule = job->data;
+        rule = job->data.rule;
+        process = job->data.process;
+        bool batch = job->data.batch;
         runningJobs.remove(job);
-        if(!rule->continueExecution(pid))
+        if(batch)
+        {
+          for(Rule* i = rule; i; i = i->nextInBatch)
+            releaseBatchOutputs(*i, usedBatchOutputs);
+          if(!rule->finishBatch(*process))
+            failure = true;
+          idleProcesses.append(process);
+          goto finishedRuleExecution;
+        }
+        if(!rule->continueExecution(*process, pid))
         {
           failure = true;
+          idleProcesses.append(process);
           goto finishedRuleExecution;
         }
         if(pid)
-          runningJobs.append(pid, rule);
+          runningJobs.append(pid, Job(rule, process, false));
         else
+        {
+          idleProcesses.append(process);
           goto finishedRuleExecution;
+        }
       }
       continue;
 
     finishedRuleExecution:
-      ++finishedRules;
-      for(Map<Rule*, String>::Node* i = rule->rulePropagations.getFirst(); i; i = i->getNext())
+      for(; rule; rule = rule->nextInBatch)
       {
-        Rule& rule = *i->key;
-        ASSERT(!rule.ruleDependencies.isEmpty());
-        ++rule.finishedRuleDependencies;
-        if(rule.finishedRuleDependencies == rule.ruleDependencies.getSize())
+        ++finishedRules;
+        for(const unsigned int* i = propagations.getFirst() + propagationOffsets[rule->index], * end = propagations.getFirst() + propagationOffsets[rule->index + 1]; i < end; ++i)
         {
-          if(rule.rulePropagations.isEmpty())
-            pendingJobs.append(&rule);
-          else
-            pendingJobs.prepend(&rule);
+          unsigned int index = *i;
+          unsigned int dependencyCount = dependencyOffsets[index + 1] - dependencyOffsets[index];
+          ASSERT(dependencyCount > 0);
+          if(++finishedDependencies[index] == dependencyCount)
+          {
+            if(propagationOffsets[index + 1] == propagationOffsets[index])
+              pendingJobs.append(rules[index]);
+            else
+              pendingJobs.prepend(rules[index]);
+          }
         }
       }
-    } while(!runningJobs.isEmpty() || (!pendingJobs.isEmpty() && !failure));
+    } while(!runningJobs.isEmpty() || ((!pendingJobs.isEmpty() || !batchedRules.isEmpty()) && !failure));
 
     if(failure)
       return false;
@@ -610,87 +941,1253 @@ public:
 
     return true;;
   }
-};
 
-bool Mare::buildTargets(const String& platform, const String& configuration)
-{
-  RuleSet ruleSet;
+private:
+  class Edge
+  {
+  public:
+    unsigned int rule;
+    unsigned int dependency;
+    unsigned int input; /**< The index of the input file (or of the imported compiled module interface) of \c rule that is built by \c dependency */
+  };
 
-  Map<String, void*> activateTargets;
-  for(const List<String>::Node* i = inputTargets.getFirst(); i; i = i->getNext())
-    activateTargets.append(i->data, 0);
+  class Job
+  {
+  public:
+    Rule* rule;
+    Process* process;
+    bool batch; /**< Whether the job applies the rules chained with Rule::nextInBatch using a batch command */
 
-  List<String> files;
-  for(List<String>::Node* i = allTargets.getFirst(); i; i = i->getNext())
+    Job() {}
+    Job(Rule* rule, Process* process, bool batch) : rule(rule), process(process), batch(batch) {}
+  };
+
+  class Dependency
   {
-    engine.enterUnnamedKey();
-    engine.addDefaultKey("platform", platform);
-    engine.addDefaultKey(platform, platform);
-    engine.addDefaultKey("configuration", configuration);
-    engine.addDefaultKey(configuration, configuration);
-    engine.addDefaultKey("target", i->data);
-    //engine.addDefaultKey(i->data, i->data);
-    engine.enterRootKey();
-    VERIFY(engine.enterKey("targets"));
-    if(!engine.enterKey(i->data))
-    {
-      engine.error(String().format(256, "cannot find target \"%s\"", i->data.getData()));
-      return false;
+  public:
+    unsigned int rule; /**< The index of the rule that builds the input file */
+    unsigned int input; /**< The index of the input file in the inputs of the dependent rule (indices past the inputs refer to Rule::moduleInputs) */
+  };
+
+  Array<Rule*> rules; /**< The rules of all targets indexed by Rule::index */
+  Array<unsigned int> dependencyOffsets; /**< The dependencies of rule i are dependencies[dependencyOffsets[i]] to dependencies[dependencyOffsets[i + 1] - 1] */
+  Array<Dependency> dependencies;
+  Array<unsigned int> propagationOffsets; /**< The rules that depend on rule i are propagations[propagationOffsets[i]] to propagations[propagationOffsets[i + 1] - 1] */
+  Array<unsigned int> propagations;
+
+  /** Reserves the files written by the batch command of a rule unless they are written by another rule of a running batch or of the batch that is being put together */
+  static bool useBatchOutputs(Rule& rule, Map<String, Rule*>& usedBatchOutputs)
+  {
+    for(const String* i = rule.batchOutputs.getFirst(), * end = rule.batchOutputs.getEnd(); i < end; ++i)
+      if(usedBatchOutputs.find(*i))
+        return false;
+    for(const String* i = rule.batchOutputs.getFirst(), * end = rule.batchOutputs.getEnd(); i < end; ++i)
+      usedBatchOutputs.append(*i, &rule);
+    return true;
+  }
+
+  static void releaseBatchOutputs(const Rule& rule, Map<String, Rule*>& usedBatchOutputs)
+  {
+    for(const String* i = rule.batchOutputs.getFirst(), * end = rule.batchOutputs.getEnd(); i < end; ++i)
+    {
+      Map<String, Rule*>::Node* node = usedBatchOutputs.find(*i);
+      if(node && node->data == &rule)
+        usedBatchOutputs.remove(node);
     }
-    engine.addDefaultKey("mareDir", engine.getMareDir());
+  }
 
-    Target& target = ruleSet.targets.append(i->data);
-    if(activateTargets.find(i->data))
+  /** Checks whether the module scan file of a rule is missing or older than one of its input files */
+  static bool isScanOutdated(const Rule& rule, bool showDebug)
+  {
+    long long scanTime;
+    if(!File::getWriteTime(rule.moduleScanFile, scanTime))
     {
-      target.active = true;
-      ruleSet.activeTargets.append(&target);
+      if(showDebug)
+        printf("debug: Scanning \"%s\" for modules since the scan file \"%s\" does not exist\n", rule.name.getData(), rule.moduleScanFile.getData());
+      return true;
     }
-    
-    // add rule for each source file
-    if(engine.enterKey("files"))
+    for(const String* i = rule.inputs.getFirst(), * end = rule.inputs.getEnd(); i < end; ++i)
     {
-      files.clear();
-      engine.getKeys(files);
-      for(List<String>::Node* i = files.getFirst(); i; i = i->getNext())
+      long long writeTime;
+      if(!File::getWriteTime(*i, writeTime) || writeTime > scanTime)
       {
-        Rule& rule = target.rules.append();
-        rule.builder = this;
-        rule.target = &target;
-        rule.name = i->data;
-        engine.enterUnnamedKey();
-        engine.addDefaultKey("file", i->data);
-        VERIFY(engine.enterKey(i->data));
-        engine.getKeys("dependencies", rule.dependencies, false);
-        engine.getKeys("input", rule.inputs, false);
-        engine.getKeys("output", rule.outputs, false);
-        engine.getText("command", rule.command, false);
-        engine.getText("message", rule.message, false);
-        engine.leaveKey(); // VERIFY(engine.enterKey(i->data));
-        engine.leaveKey();
+        if(showDebug)
+          printf("debug: Scanning \"%s\" for modules since the input file \"%s\" is newer than the scan file\n", rule.name.getData(), i->getData());
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /** Writes a module mapper file unless it already has the given content (to keep its modification time) */
+  static bool writeModuleMapper(const String& file, const String& text)
+  {
+    {
+      File oldFile;
+      if(oldFile.open(file))
+      {
+        String oldText;
+        char buffer[4096];
+        size_t i;
+        while((i = oldFile.read(buffer, sizeof(buffer))) > 0)
+          oldText.append(buffer, i);
+        if(oldText == text)
+          return true;
       }
-      engine.leaveKey();
     }
+    File newFile;
+    return Directory::create(File::getDirname(file)) && newFile.open(file, File::writeFlag) && newFile.write(text);
+  }
 
-    // add rule for target file
-    Rule& rule = target.rules.append();
-    rule.builder = this;
-    rule.target = &target;
-    rule.name = i->data;
-    target.rule = &rule;
-    engine.getKeys("dependencies", rule.dependencies, false);
-    engine.getKeys("input", rule.inputs, false);
-    engine.getKeys("output", rule.outputs, false);
-    engine.getText("command", rule.command, false);
-    engine.getText("message", rule.message, false);
+  /** Returns an input file of a rule that was built by another rule that has been applied */
+  const String* getRebuiltInput(const Rule& rule) const
+  {
+    for(const Dependency* i = dependencies.getFirst() + dependencyOffsets[rule.index], * end = dependencies.getFirst() + dependencyOffsets[rule.index + 1]; i < end; ++i)
+      if(rules[i->rule]->rebuild)
+        return i->input < rule.inputs.getSize() ? &rule.inputs[i->input] : &rule.moduleInputs[i->input - rule.inputs.getSize()];
+    return 0;
+  }
+};
 
-    engine.leaveKey();
-    engine.leaveKey();
-    engine.leaveKey();
-    engine.leaveKey();
+bool Mare::build(const Map<String, String>& userArgs)
+{
+  // reuse the rules of a previous run if the Marefile and everything it depends on did not change
+  String cacheKey = getCacheKey(userArgs);
+  String cacheFile;
+  {
+    MD5 md5;
+    md5.update((const unsigned char*)cacheKey.getData(), static_cast<unsigned>(cacheKey.getLength()));
+    unsigned char sum[16];
+    md5.final(sum);
+    cacheFile.format(64, ".mare/%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x",
+      sum[0], sum[1], sum[2], sum[3], sum[4], sum[5], sum[6], sum[7], sum[8], sum[9], sum[10], sum[11], sum[12], sum[13], sum[14], sum[15]);
+  }
+
+  // a rebuilt mare might create different rules (it replaces the cache file, since the name of the file does not depend on this)
+  String executable = Process::getExecutablePath();
+  long long executableWriteTime;
+  if(!executable.isEmpty() && File::getWriteTime(executable, executableWriteTime))
+    cacheKey.append(String().format(executable.getLength() + 64, "\nmare %s %lld", executable.getData(), executableWriteTime));
+  List<RuleSet> ruleSets;
+  this->userArgs = &userArgs;
+  bool cached = loadCache(cacheFile, cacheKey, ruleSets);
+  if(!cached)
+  {
+    if(!loadFile())
+      return false;
+    if(!buildFile(ruleSets))
+      return false;
+  }
+  else if(ruleSets.getSize() > 1)
+    for(const List<RuleSet>::Node* i = ruleSets.getFirst(); i; i = i->getNext())
+      addVariantKeys(i->data.platform, i->data.configuration);
+
+  // determine the number of parallel jobs (by default, as many as there are processors and there is memory for)
+  unsigned int maxParallelJobs = jobs;
+  if(jobs <= 0)
+  {
+    unsigned int processors = Process::getProcessorCount();
+    unsigned long long memory = Process::getAvailableMemory();
+    maxParallelJobs = processors - jobs;
+    if(jobs == 0 && memory)
+    {
+      unsigned long long memoryJobs = memory / (512 * 1024 * 1024); // a compiler process may need about 512 MB
+      if(memoryJobs < maxParallelJobs)
+        maxParallelJobs = memoryJobs > 0 ? (unsigned int)memoryJobs : 1;
+    }
+    if(showDebug)
+      printf("debug: Using %u parallel jobs (%u processors, %u MB of memory available)\n", maxParallelJobs, processors, (unsigned int)(memory / (1024 * 1024)));
+  }
+
+  // share the job slots with the tools launched by the rules (or with the make that launched mare)
+  JobServer jobServer;
+  jobServer.start(maxParallelJobs, showDebug);
+
+  // build input targets (with dependencies) foreach input configuration
+  bool success = true;
+  for(List<RuleSet>::Node* i = ruleSets.getFirst(); i; i = i->getNext())
+  {
+    RuleSet& ruleSet = i->data;
+    if(!ruleSet.scanModules(engine, jobServer, maxParallelJobs, clean, rebuild, showDebug))
+    {
+      success = false;
+      break;
+    }
+    ruleSet.resolveDependencies(!ignoreDependencies);
+    bool built = ruleSet.build(engine, jobServer, maxParallelJobs, clean, rebuild, showDebug);
+    leaveEvaluatedTarget();
+    if(!built)
+    {
+      success = false;
+      break;
+    }
   }
 
-  ruleSet.resolveDependencies(!ignoreDependencies);
-  return ruleSet.build(engine, jobs <= 0 ? (Process::getProcessorCount() - jobs) : jobs, clean, rebuild, showDebug);
+  // the commands of rules that had to be applied are saved as well (unless a rule failed)
+  if(!cached && success)
+    saveCache(cacheFile, cacheKey, ruleSets);
+  return success;
+}
+
+bool Mare::loadFile()
+{
+  if(!loaded)
+  {
+    if(!engine.load(inputFile))
+      return false;
+    addDefaultKeys(*userArgs);
+    loaded = true;
+  }
+  return true;
+}
+
+bool Mare::evaluateCommands(Rule& rule)
+{
+  // the Marefile has not been evaluated if the rules were loaded from the cache
+  if(!loadFile())
+    return false;
+
+  // the target stays entered, since the next rule that has to be applied is likely to belong to the same target
+  Target& target = *rule.target;
+  if(evaluatedTarget != &target)
+  {
+    leaveEvaluatedTarget();
+    if(!enterTarget(target.ruleSet->platform, target.ruleSet->configuration, target.rule->name, &target))
+      return false;
+    evaluatedTarget = &target;
+  }
+
+  // evaluate the commands of the rule only, since the other rules of the target might not have to be applied
+  if(&rule != target.rule && rule.precompiledHeaderRule.isEmpty())
+  {
+    if(!evaluatedFiles)
+    {
+      if(!engine.enterKey("files"))
+      {
+        rule.evaluated = true;
+        return true;
+      }
+      List<String> files;
+      engine.getKeys(files); // compile the file list before entering a file key
+      evaluatedFiles = true;
+    }
+    engine.enterUnnamedKey();
+    engine.addDefaultKey("file", rule.name);
+    if(engine.enterKey(rule.unitySources.isEmpty() ? rule.name : rule.unitySources[0]))
+    {
+      engine.getText("command", rule.command, false);
+      engine.getText("message", rule.message, false);
+      Array<String> batchCommand;
+      engine.getText("batchCommand", batchCommand, false);
+      for(const String* i = batchCommand.getFirst(), * end = batchCommand.getEnd(); i < end; ++i)
+        if(!i->isEmpty())
+        {
+          rule.batchCommand = *i;
+          if(rule.batchDir.isEmpty())
+            rule.batchDir = ".";
+          engine.getKeys("batchOutput", rule.batchOutputs, false);
+          for(String* i = rule.batchOutputs.getFirst(), * end = rule.batchOutputs.getEnd(); i < end; ++i)
+            if(!File::isPathAbsolute(*i))
+              *i = rule.batchDir + "/" + *i;
+          break;
+        }
+      engine.leaveKey();
+    }
+    engine.leaveKey();
+  }
+  else
+  {
+    if(evaluatedFiles)
+    {
+      engine.leaveKey();
+      evaluatedFiles = false;
+    }
+    if(&rule == target.rule)
+    {
+      engine.getText("command", rule.command, false);
+      engine.getText("message", rule.message, false);
+    }
+    else
+    {
+      engine.enterUnnamedKey();
+      engine.addDefaultKey("file", rule.name);
+      if(engine.enterKey(rule.precompiledHeaderRule))
+      {
+        engine.getText("command", rule.command, false);
+        engine.getText("message", rule.message, false);
+        engine.leaveKey();
+      }
+      engine.leaveKey();
+    }
+  }
+  rule.evaluated = true;
+  if(rule.command.isEmpty() && !rule.outputs.isEmpty() && rule.precompiledHeaderRule.isEmpty())
+    printf("warning: Rule for \"%s\" does not define a command\n", rule.name.getData());
+  return true;
+}
+
+void Mare::leaveEvaluatedTarget()
+{
+  if(evaluatedFiles)
+  {
+    engine.leaveKey();
+    evaluatedFiles = false;
+  }
+  if(evaluatedTarget)
+  {
+    leaveTarget();
+    evaluatedTarget = 0;
+  }
+}
+
+/** Computes the MD5 checksum of the arguments (e.g. "$(md5 $(cppFlags))") for naming files that depend on them */
+static void md5Function(void* userData, const List<String>& args, String& output)
+{
+  MD5 md5;
+  for(const List<String>::Node* i = args.getFirst(); i; i = i->getNext())
+  {
+    if(i != args.getFirst())
+      md5.update((const unsigned char*)",", 1);
+    md5.update((const unsigned char*)i->data.getData(), static_cast<unsigned>(i->data.getLength()));
+  }
+  unsigned char sum[16];
+  md5.final(sum);
+  String result;
+  result.format(33, "%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x",
+    sum[0], sum[1], sum[2], sum[3], sum[4], sum[5], sum[6], sum[7], sum[8], sum[9], sum[10], sum[11], sum[12], sum[13], sum[14], sum[15]);
+  output.append(result);
+}
+
+void Mare::addDefaultKeys(const Map<String, String>& userArgs)
+{
+  engine.addFunction("md5", md5Function);
+
+  // add default rules and stuff
+  engine.addDefaultKey("cCompiler", "gcc");
+  engine.addDefaultKey("cppCompiler", "g++");
+  engine.addDefaultKey("configurations", "Debug Release");
+  engine.addDefaultKey("targets"); // an empty target list exists per default
+  engine.addDefaultKey("buildDir", "$(configuration)");
+  engine.addDefaultKey("outputDir", "$(buildDir)");
+  engine.addDefaultKey("precompiledHeaderDir", "$(buildDir)/.pch");
+  engine.addDefaultKey("moduleMapper", "$(buildDir)/.modules/mapper");
+  engine.addDefaultKey("cFlags", "-Wall $(if $(Debug),-g,-Os -fomit-frame-pointer)");
+  engine.addDefaultKey("cppFlags", "-Wall $(if $(Debug),-g,-Os -fomit-frame-pointer)");
+  engine.addDefaultKey("linkFlags", "$(if $(Debug),,-s)");
+  {
+    Map<String, String> cppApplication;
+    cppApplication.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(patsubst $(buildDir)/%,%,$(filter %.c%,$(filter-out $(__unitySources),$(files)) $(__unityFiles)))))))");
+    cppApplication.append("output", "$(outputDir)/$(target)$(if $(Win32),.exe)");
+    cppApplication.append("command", "$(linker) -o $(output) $(input) $(linkFlags) $(LDFLAGS) $(patsubst %,-L%,$(libPaths)) $(patsubst %,-l%,$(libs))$(if $(lto), -flto=jobserver)");
+    cppApplication.append("message", "-> $(output)");
+    cppApplication.append("linker", "$(if $(linker),$(linker),$(cppCompiler))");
+    cppApplication.append("__pchRule", "cppPrecompiledHeader");
+    engine.addDefaultKey("cppApplication", cppApplication);
+  }
+  {
+    Map<String, String> cppDynamicLibrary;
+    cppDynamicLibrary.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(patsubst $(buildDir)/%,%,$(filter %.c%,$(filter-out $(__unitySources),$(files)) $(__unityFiles)))))))");
+    cppDynamicLibrary.append("output", "$(outputDir)/$(if $(Win32),,lib)$(patsubst lib%,%,$(target))$(if $(Win32),.dll,.so)");
+    cppDynamicLibrary.append("__soFlags", "$(if $(Win32),,-fpic)");
+    cppDynamicLibrary.append("command", "$(linker) -shared $(__soFlags) -o $(output) $(input) $(linkFlags) $(LDFLAGS) $(patsubst %,-L%,$(libPaths)) $(patsubst %,-l%,$(libs))$(if $(lto), -flto=jobserver)");
+    cppDynamicLibrary.append("message", "-> $(output)");
+    cppDynamicLibrary.append("linker", "$(if $(linker),$(linker),$(cppCompiler))");
+    cppDynamicLibrary.append("__pchRule", "cppPrecompiledHeader");
+    engine.addDefaultKey("cppDynamicLibrary", cppDynamicLibrary);
+  }
+  {
+    Map<String, String> cppStaticLibrary;
+    cppStaticLibrary.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(patsubst $(buildDir)/%,%,$(filter %.c%,$(filter-out $(__unitySources),$(files)) $(__unityFiles)))))))");
+    cppStaticLibrary.append("output", "$(outputDir)/$(if $(Win32),,lib)$(patsubst lib%,%,$(target))$(if $(Win32),.lib,.a)");
+    cppStaticLibrary.append("command", "$(linker) rcs $(output) $(input)");
+    cppStaticLibrary.append("message", "-> $(output)");
+    cppStaticLibrary.append("linker", "$(if $(linker),$(linker),$(if $(lto),gcc-ar,ar))");
+    cppStaticLibrary.append("__pchRule", "cppPrecompiledHeader");
+    engine.addDefaultKey("cppStaticLibrary", cppStaticLibrary);
+  }
+  {
+    Map<String, String> cApplication;
+    cApplication.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(patsubst $(buildDir)/%,%,$(filter %.c%,$(filter-out $(__unitySources),$(files)) $(__unityFiles)))))))");
+    cApplication.append("output", "$(outputDir)/$(target)$(if $(Win32),.exe)");
+    cApplication.append("command", "$(linker) -o $(output) $(input) $(linkFlags) $(LDFLAGS) $(patsubst %,-L%,$(libPaths)) $(patsubst %,-l%,$(libs))$(if $(lto), -flto=jobserver)");
+    cApplication.append("message", "-> $(output)");
+    cApplication.append("linker", "$(if $(linker),$(linker),$(cCompiler))");
+    cApplication.append("__pchRule", "cPrecompiledHeader");
+    engine.addDefaultKey("cApplication", cApplication);
+  }
+  {
+    Map<String, String> cDynamicLibrary;
+    cDynamicLibrary.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(patsubst $(buildDir)/%,%,$(filter %.c%,$(filter-out $(__unitySources),$(files)) $(__unityFiles)))))))");
+    cDynamicLibrary.append("output", "$(outputDir)/$(if $(Win32),,lib)$(patsubst lib%,%,$(target))$(if $(Win32),.dll,.so)");
+    cDynamicLibrary.append("__soFlags", "$(if $(Win32),,-fpic)");
+    cDynamicLibrary.append("command", "$(linker) -shared $(__soFlags) -o $(output) $(input) $(linkFlags) $(LDFLAGS) $(patsubst %,-L%,$(libPaths)) $(patsubst %,-l%,$(libs))$(if $(lto), -flto=jobserver)");
+    cDynamicLibrary.append("message", "-> $(output)");
+    cDynamicLibrary.append("linker", "$(if $(linker),$(linker),$(cCompiler))");
+    cDynamicLibrary.append("__pchRule", "cPrecompiledHeader");
+    engine.addDefaultKey("cDynamicLibrary", cDynamicLibrary);
+  }
+  {
+    Map<String, String> cStaticLibrary;
+    cStaticLibrary.append("input", "$(addprefix $(buildDir)/,$(addsuffix .o,$(basename $(subst ../,,$(patsubst $(buildDir)/%,%,$(filter %.c%,$(filter-out $(__unitySources),$(files)) $(__unityFiles)))))))");
+    cStaticLibrary.append("output", "$(outputDir)/$(if $(Win32),,lib)$(patsubst lib%,%,$(target))$(if $(Win32),.lib,.a)");
+    cStaticLibrary.append("command", "$(linker) rcs $(output) $(input)");
+    cStaticLibrary.append("message", "-> $(output)");
+    cStaticLibrary.append("linker", "$(if $(linker),$(linker),$(if $(lto),gcc-ar,ar))");
+    cStaticLibrary.append("__pchRule", "cPrecompiledHeader");
+    engine.addDefaultKey("cStaticLibrary", cStaticLibrary);
+  }
+  {
+    Map<String, String> cppSource;
+    cppSource.append("__ofile", "$(buildDir)/$(basename $(subst ../,,$(patsubst $(buildDir)/%,%,$(file)))).o");
+    cppSource.append("__dfile", "$(patsubst %.o,%.d,$(__ofile))");
+    cppSource.append("input", "$(file) $(filter-out %.o: \\,$(readfile $(__dfile))) $(if $(__cppPch),$(__cppPch).gch)");
+    cppSource.append("output", "$(__ofile) $(__dfile)");
+    cppSource.append("command", "$(cppCompiler) -MMD $(__soFlags) -o $(__ofile) -c $(file) $(cppFlags) $(CXXFLAGS) $(CPPFLAGS) $(LDFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths))$(if $(__cppPch), -include $(__cppPch) -Winvalid-pch)$(if $(modules), -fmodules-ts -Mno-modules -fmodule-mapper=$(moduleMapper))$(if $(lto), -flto -fno-fat-lto-objects)");
+    cppSource.append("message", "$(subst ./,,$(file))");
+    cppSource.append("batchCommand", "$(if $(batch),$(if $(modules),,$(cppCompiler) -MMD $(__soFlags) -c $(cppFlags) $(CXXFLAGS) $(CPPFLAGS) $(LDFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(abspath $(includePaths)))$(if $(__cppPch), -include $(abspath $(__cppPch)) -Winvalid-pch)$(if $(lto), -flto -fno-fat-lto-objects)))");
+    cppSource.append("batchDir", "$(buildDir)/.batch");
+    cppSource.append("batchOutput", "$(notdir $(basename $(file))).o $(notdir $(basename $(file))).d");
+    cppSource.append("unityFile", "$(buildDir)/.unity/$(target)_%.cpp");
+    cppSource.append("__ddifile", "$(patsubst %.o,%.ddi,$(__ofile))");
+    cppSource.append("moduleScanFile", "$(if $(modules),$(__ddifile))");
+    cppSource.append("moduleScanCommand", "$(cppCompiler) -E -x c++ $(file) -fmodules-ts -fdeps-format=p1689r5 -fdeps-file=$(__ddifile) -fdeps-target=$(__ofile) -o $(if $(Win32),NUL,/dev/null) $(__soFlags) $(cppFlags) $(CXXFLAGS) $(CPPFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths))");
+    engine.addDefaultKey("cppSource", cppSource);
+  }
+  engine.addDefaultKey("__cppPch", "$(if $(filter cppPrecompiledHeader,$(__pchRule)),$(if $(precompiledHeader),$(precompiledHeaderDir)/$(md5 $(cppCompiler) $(__soFlags) $(cppFlags) $(CXXFLAGS) $(CPPFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths)) $(precompiledHeader))/$(notdir $(precompiledHeader))))");
+  {
+    Map<String, String> cppPrecompiledHeader;
+    cppPrecompiledHeader.append("input", "$(file) $(filter-out %.gch: \\,$(readfile $(__cppPch).d))");
+    cppPrecompiledHeader.append("output", "$(__cppPch).gch $(__cppPch).d");
+    cppPrecompiledHeader.append("command", "$(cppCompiler) -MMD -MF $(__cppPch).d $(__soFlags) -x c++-header -o $(__cppPch).gch -c $(file) $(cppFlags) $(CXXFLAGS) $(CPPFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths))");
+    cppPrecompiledHeader.append("message", "$(subst ./,,$(file))");
+    engine.addDefaultKey("cppPrecompiledHeader", cppPrecompiledHeader);
+  }
+  {
+    Map<String, String> cSource;
+    cSource.append("__ofile", "$(buildDir)/$(basename $(subst ../,,$(patsubst $(buildDir)/%,%,$(file)))).o");
+    cSource.append("__dfile", "$(patsubst %.o,%.d,$(__ofile))");
+    cSource.append("input", "$(file) $(filter-out %.o: \\,$(readfile $(__dfile))) $(if $(__cPch),$(__cPch).gch)");
+    cSource.append("output", "$(__ofile) $(__dfile)");
+    cSource.append("command", "$(cCompiler) -MMD $(__soFlags) -o $(__ofile) -c $(file) $(cFlags) $(CFLAGS) $(CPPFLAGS) $(LDFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths))$(if $(__cPch), -include $(__cPch) -Winvalid-pch)$(if $(lto), -flto -fno-fat-lto-objects)");
+    cSource.append("message", "$(subst ./,,$(file))");
+    cSource.append("batchCommand", "$(if $(batch),$(cCompiler) -MMD $(__soFlags) -c $(cFlags) $(CFLAGS) $(CPPFLAGS) $(LDFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(abspath $(includePaths)))$(if $(__cPch), -include $(abspath $(__cPch)) -Winvalid-pch)$(if $(lto), -flto -fno-fat-lto-objects))");
+    cSource.append("batchDir", "$(buildDir)/.batch");
+    cSource.append("batchOutput", "$(notdir $(basename $(file))).o $(notdir $(basename $(file))).d");
+    cSource.append("unityFile", "$(buildDir)/.unity/$(target)_%.c");
+    engine.addDefaultKey("cSource", cSource);
+  }
+  engine.addDefaultKey("__cPch", "$(if $(filter cPrecompiledHeader,$(__pchRule)),$(if $(precompiledHeader),$(precompiledHeaderDir)/$(md5 $(cCompiler) $(__soFlags) $(cFlags) $(CFLAGS) $(CPPFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths)) $(precompiledHeader))/$(notdir $(precompiledHeader))))");
+  {
+    Map<String, String> cPrecompiledHeader;
+    cPrecompiledHeader.append("input", "$(file) $(filter-out %.gch: \\,$(readfile $(__cPch).d))");
+    cPrecompiledHeader.append("output", "$(__cPch).gch $(__cPch).d");
+    cPrecompiledHeader.append("command", "$(cCompiler) -MMD -MF $(__cPch).d $(__soFlags) -x c-header -o $(__cPch).gch -c $(file) $(cFlags) $(CFLAGS) $(CPPFLAGS) $(patsubst %,-D%,$(defines)) $(patsubst %,-I%,$(includePaths))");
+    cPrecompiledHeader.append("message", "$(subst ./,,$(file))");
+    engine.addDefaultKey("cPrecompiledHeader", cPrecompiledHeader);
+  }
+#if defined(_WIN32) || defined(__CYGWIN__)
+  String platform("Win32");
+#elif defined(__linux)
+  String platform("Linux");
+#elif defined(__APPLE__) && defined(__MACH__)
+  String platform("MacOSX");
+#else
+  String platform("unknown");
+  // add your os :)
+  // http://predef.sourceforge.net/preos.html
+#endif
+  engine.addDefaultKey("host", platform); // the platform on which the compiler is run
+  engine.addDefaultKey("platforms", platform); // the target platform of the compiler
+
+  String architecture = Process::getArchitecture();
+  engine.addDefaultKey("architecture", architecture);
+  engine.addDefaultKey("arch", architecture);
+
+  // add user arguments
+  for(const Map<String, String>::Node* i = userArgs.getFirst(); i; i = i->getNext())
+    engine.addCommandLineKey(i->key, i->data);
+}
+
+bool Mare::buildFile(List<RuleSet>& ruleSets)
+{
+  // enter root key
+  engine.enterRootKey();
+
+  // read default or check input platform names
+  VERIFY(engine.enterKey("platforms"));
+  if(inputPlatforms.isEmpty())
+  {
+    String firstPlatform = engine.getFirstKey();
+    if(!firstPlatform.isEmpty())
+      inputPlatforms.append(firstPlatform);
+    else
+    {
+      engine.error("cannot find any platforms");
+      return false;
+    }
+  }
+  else
+    for(const List<String>::Node* i = inputPlatforms.getFirst(); i; i = i->getNext())
+      if(!engine.hasKey(i->data))
+      {
+        engine.error(String().format(256, "cannot find platform \"%s\"", i->data.getData()));
+        return false;
+      }
+  engine.leaveKey();
+
+  // read default or check input configuration names
+  VERIFY(engine.enterKey("configurations"));
+  if(inputConfigs.isEmpty())
+  {
+    String firstConfiguration = engine.getFirstKey();
+    if(!firstConfiguration.isEmpty())
+      inputConfigs.append(firstConfiguration);
+    else
+    {
+      engine.error("cannot find any configurations");
+      return false;
+    }
+  }
+  else
+    for(const List<String>::Node* i = inputConfigs.getFirst(); i; i = i->getNext())
+      if(!engine.hasKey(i->data))
+      {
+        engine.error(String().format(256, "cannot find configuration \"%s\"", i->data.getData()));
+        return false;
+      }
+  engine.leaveKey();
+
+  // read default or check input target names
+  VERIFY(engine.enterKey("targets"));
+  engine.getKeys(allTargets);
+  if(inputTargets.isEmpty())
+  {
+    if(!allTargets.isEmpty())
+      inputTargets.append(allTargets.getFirst()->data);
+    else
+    {
+      engine.error("cannot find any targets");
+      return false;
+    }
+  }
+  else
+    for(const List<String>::Node* i = inputTargets.getFirst(); i; i = i->getNext())
+      if(!engine.hasKey(i->data))
+      {
+        engine.error(String().format(256, "cannot find target \"%s\"", i->data.getData()));
+        return false;
+      }
+  engine.leaveKey();
+
+  // leave root key
+  engine.leaveKey(); 
+
+  // evaluate the rules of the input targets foreach input configuration
+  if(inputPlatforms.getSize() * inputConfigs.getSize() > 1)
+    for(const List<String>::Node* i = inputPlatforms.getFirst(); i; i = i->getNext())
+      for(const List<String>::Node* j = inputConfigs.getFirst(); j; j = j->getNext())
+        addVariantKeys(i->data, j->data);
+  for(const List<String>::Node* i = inputPlatforms.getFirst(); i; i = i->getNext())
+  {
+    const String& platform = i->data;
+    for(const List<String>::Node* i = inputConfigs.getFirst(); i; i = i->getNext())
+    {
+      const String& configuration = i->data;
+      RuleSet& ruleSet = ruleSets.append();
+      ruleSet.platform = platform;
+      ruleSet.configuration = configuration;
+      if(!buildTargets(platform, configuration, ruleSet))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+bool Mare::buildTargets(const String& platform, const String& configuration, RuleSet& ruleSet)
+{
+  Map<String, void*> pendingTargets;
+  for(const List<String>::Node* i = allTargets.getFirst(); i; i = i->getNext())
+    pendingTargets.append(i->data, 0);
+
+  // evaluate the rules of the input targets
+  for(const List<String>::Node* i = inputTargets.getFirst(); i; i = i->getNext())
+  {
+    Map<String, void*>::Node* node = pendingTargets.find(i->data);
+    if(!node)
+      continue;
+    pendingTargets.remove(node);
+    if(!buildTarget(platform, configuration, i->data, ruleSet))
+      return false;
+  }
+  if(ignoreDependencies)
+    return true;
+
+  // evaluate the rules of the targets the active targets depend on
+  Map<String, void*> checkedInputs; // the outputs of active rules and the inputs that have been looked up already
+  Map<String, String> outputToTarget; // the outputs of the pending targets that have been evaluated so far
+  bool outputsEvaluated = false;
+  const List<Target*>::Node* checkedTarget = 0;
+  for(List<Target*>::Node* i = ruleSet.activeTargets.getFirst(); i; i = i->getNext())
+  {
+    // the outputs of the targets that became active do not have to be looked up
+    for(const List<Target*>::Node* k = checkedTarget ? checkedTarget->getNext() : ruleSet.activeTargets.getFirst(); k; k = k->getNext())
+    {
+      for(const List<Rule>::Node* j = k->data->rules.getFirst(); j; j = j->getNext())
+        for(const String* l = j->data.outputs.getFirst(), * end = j->data.outputs.getEnd(); l < end; ++l)
+          if(!checkedInputs.find(*l))
+            checkedInputs.append(*l, 0);
+      checkedTarget = k;
+    }
+
+    for(List<Rule>::Node* j = i->data->rules.getFirst(); j; j = j->getNext())
+    {
+      const Rule& rule = j->data;
+      for(const String* i = rule.dependencies.getFirst(), * end = rule.dependencies.getEnd(); i < end; ++i)
+      {
+        Map<String, void*>::Node* node = pendingTargets.find(*i);
+        if(!node)
+          continue;
+        pendingTargets.remove(node);
+        if(!buildTarget(platform, configuration, *i, ruleSet))
+          return false;
+      }
+
+      for(const String* i = rule.inputs.getFirst(), * end = rule.inputs.getEnd(); i < end && !pendingTargets.isEmpty(); ++i)
+      {
+        if(checkedInputs.find(*i))
+          continue;
+        checkedInputs.append(*i, 0);
+
+        // an input file might be built by a target that has not been evaluated yet (only the "output" keys of these targets are evaluated for this)
+        if(!outputsEvaluated)
+        {
+          Array<String> outputs;
+          for(const Map<String, void*>::Node* i = pendingTargets.getFirst(); i; i = i->getNext())
+          {
+            if(!enterTarget(platform, configuration, i->key))
+              return false;
+            outputs.clear();
+            engine.getKeys("output", outputs, false);
+            for(const String* j = outputs.getFirst(), * end = outputs.getEnd(); j < end; ++j)
+              if(!outputToTarget.find(*j))
+                outputToTarget.append(*j, i->key);
+            leaveTarget();
+          }
+          outputsEvaluated = true;
+        }
+        const Map<String, String>::Node* target = outputToTarget.find(*i);
+
+        // a missing input file might be an intermediate file of a target, so the "files" rules of the pending targets are evaluated until one of them builds it
+        if(!target && !File::exists(*i))
+        {
+          Array<String> outputs;
+          Array<String> files;
+          for(Map<String, void*>::Node* j = pendingTargets.getFirst(); j && !target; j = j->getNext())
+          {
+            if(j->data)
+              continue; // the outputs of its "files" rules have been evaluated already
+            j->data = (void*)1;
+            if(!enterTarget(platform, configuration, j->key))
+              return false;
+            if(engine.enterKey("files"))
+            {
+              outputs.clear();
+              files.clear();
+              engine.getKeys(files);
+              for(const String* k = files.getFirst(), * end = files.getEnd(); k < end; ++k)
+              {
+                engine.enterUnnamedKey();
+                engine.addDefaultKey("file", *k);
+                VERIFY(engine.enterKey(*k));
+                engine.getKeys("output", outputs, false);
+                engine.leaveKey();
+                engine.leaveKey();
+              }
+              engine.leaveKey();
+              for(const String* k = outputs.getFirst(), * end = outputs.getEnd(); k < end; ++k)
+                if(!outputToTarget.find(*k))
+                  outputToTarget.append(*k, j->key);
+              target = outputToTarget.find(*i);
+            }
+            leaveTarget();
+          }
+        }
+
+        if(!target)
+          continue;
+        Map<String, void*>::Node* node = pendingTargets.find(target->data);
+        if(!node)
+          continue;
+        pendingTargets.remove(node);
+        if(!buildTarget(platform, configuration, target->data, ruleSet))
+          return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool Mare::buildTarget(const String& platform, const String& configuration, const String& name, RuleSet& ruleSet)
+{
+  if(!enterTarget(platform, configuration, name))
+    return false;
+
+  Target& target = ruleSet.targets.append(name);
+  target.ruleSet = &ruleSet;
+  target.active = true;
+  ruleSet.activeTargets.append(&target);
+
+  // add rule for each source file
+  if(engine.enterKey("files"))
+  {
+    Array<String> files;
+    engine.getKeys(files);
+    bool modules = !engine.getFirstKey("modules").isEmpty();
+    bool unity = !modules && atoi(engine.getFirstKey("unity").getData()) > 1; // module units cannot be merged
+    Map<String, UnityGroup> unityGroups;
+    for(const String* i = files.getFirst(), * end = files.getEnd(); i < end; ++i)
+    {
+      engine.enterUnnamedKey();
+      engine.addDefaultKey("file", *i);
+      VERIFY(engine.enterKey(*i));
+      int unitySize = unity ? atoi(engine.getFirstKey("unity").getData()) : 0;
+      String unityFile;
+      if(unitySize > 1)
+        unityFile = engine.getFirstKey("unityFile");
+      if(unityFile.isEmpty())
+      {
+        Rule& rule = addFileRule(target, *i);
+        if(modules)
+        {
+          rule.moduleScanFile = engine.getFirstKey("moduleScanFile", false);
+          if(!rule.moduleScanFile.isEmpty())
+          {
+            rule.moduleMapper = engine.getFirstKey("moduleMapper");
+            Array<String> command;
+            engine.getText("moduleScanCommand", command, false);
+            for(const String* j = command.getFirst(), * end = command.getEnd(); j < end; ++j)
+              if(!j->isEmpty())
+              {
+                rule.moduleScanCommand = *j;
+                break;
+              }
+          }
+        }
+      }
+      engine.leaveKey(); // VERIFY(engine.enterKey(*i));
+      engine.leaveKey();
+
+      if(!unityFile.isEmpty())
+      {
+        // a unit is compiled with the key of its first source file, so only source files that are compiled with the same command are merged (e.g. a file with its own defines is not)
+        String groupKey = unityFile;
+        engine.enterUnnamedKey();
+        engine.addDefaultKey("file", unityFile);
+        VERIFY(engine.enterKey(*i));
+        Array<String> command;
+        engine.getText("command", command, false);
+        for(const String* j = command.getFirst(), * end = command.getEnd(); j < end; ++j)
+        {
+          groupKey.append('\n');
+          groupKey.append(*j);
+        }
+        engine.leaveKey();
+        engine.leaveKey();
+
+        Map<String, UnityGroup>::Node* node = unityGroups.find(groupKey);
+        UnityGroup& group = node ? node->data : unityGroups.append(groupKey);
+        if(!node)
+        {
+          group.unityFile = unityFile;
+          group.size = unitySize;
+        }
+        group.sources.append(*i);
+      }
+    }
+
+    // add rule for each unity translation unit (the units of groups with the same unity file name are numbered consecutively)
+    Map<String, unsigned int> unityNumbers;
+    for(const Map<String, UnityGroup>::Node* i = unityGroups.getFirst(); i; i = i->getNext())
+    {
+      const UnityGroup& group = i->data;
+      Map<String, unsigned int>::Node* numberNode = unityNumbers.find(group.unityFile);
+      unsigned int& number = numberNode ? numberNode->data : unityNumbers.append(group.unityFile, 1);
+      for(size_t first = 0; first < group.sources.getSize(); first += group.size, ++number)
+      {
+        size_t count = group.sources.getSize() - first < (size_t)group.size ? group.sources.getSize() - first : group.size;
+        const String& key = group.sources[first];
+        String name = key;
+        if(count > 1)
+        {
+          char buffer[16];
+          sprintf(buffer, "%u", number);
+          name = group.unityFile;
+          const char* percent = strchr(name.getData(), '%');
+          if(percent)
+          {
+            size_t pos = percent - name.getData();
+            name = name.substr(0, pos) + String(buffer, -1) + name.substr(pos + 1);
+          }
+          if(!writeUnityFile(name, group.sources.getFirst() + first, count))
+            engine.error(String().format(256, "cannot write unity file \"%s\": %s", name.getData(), Error::getString().getData()));
+        }
+        engine.enterUnnamedKey();
+        engine.addDefaultKey("file", name);
+        VERIFY(engine.enterKey(key));
+        Rule& rule = addFileRule(target, name);
+        if(count > 1)
+        {
+          rule.unitySources.setCapacity(count);
+          for(const String* j = group.sources.getFirst() + first, * end = j + count; j < end; ++j)
+            rule.unitySources.append(*j);
+        }
+        engine.leaveKey();
+        engine.leaveKey();
+      }
+    }
+    engine.leaveKey();
+
+    // the target rule needs to know the unity translation units and the source files they include
+    if(!unityGroups.isEmpty())
+    {
+      leaveTarget();
+      if(!enterTarget(platform, configuration, name, &target))
+        return false;
+    }
+  }
+
+  // add rule for the precompiled header unless another target compiles it with the same flags
+  String precompiledHeader = engine.getFirstKey("precompiledHeader");
+  if(!precompiledHeader.isEmpty())
+  {
+    String precompiledHeaderRule = engine.getFirstKey("__pchRule");
+    engine.enterUnnamedKey();
+    engine.addDefaultKey("file", precompiledHeader);
+    if(!precompiledHeaderRule.isEmpty() && engine.enterKey(precompiledHeaderRule))
+    {
+      String output = engine.getFirstKey("output", false);
+      if(!output.isEmpty() && !ruleSet.precompiledHeaders.find(output))
+      {
+        ruleSet.precompiledHeaders.append(output, 0);
+        addFileRule(target, precompiledHeader).precompiledHeaderRule = precompiledHeaderRule;
+      }
+      engine.leaveKey();
+    }
+    engine.leaveKey();
+  }
+
+  // add rule for target file
+  Rule& rule = target.rules.append();
+  rule.builder = this;
+  rule.target = &target;
+  rule.name = name;
+  target.rule = &rule;
+  engine.getKeys("dependencies", rule.dependencies, false);
+  engine.getKeys("input", rule.inputs, false);
+  engine.getKeys("output", rule.outputs, false);
+
+  leaveTarget();
+  return true;
+}
+
+Rule& Mare::addFileRule(Target& target, const String& name)
+{
+  Rule& rule = target.rules.append();
+  rule.builder = this;
+  rule.target = &target;
+  rule.name = name;
+  engine.getKeys("dependencies", rule.dependencies, false);
+  engine.getKeys("input", rule.inputs, false);
+  engine.getKeys("output", rule.outputs, false);
+  rule.batchDir = engine.getFirstKey("batchDir", false); // it is removed with the output files even if no batch command is used
+  return rule;
+}
+
+void Mare::addUnityKeys(const Target& target)
+{
+  List<String> unityFiles;
+  List<String> unitySources;
+  for(const List<Rule>::Node* i = target.rules.getFirst(); i; i = i->getNext())
+  {
+    const Rule& rule = i->data;
+    if(rule.unitySources.isEmpty())
+      continue;
+    unityFiles.append(rule.name);
+    for(const String* j = rule.unitySources.getFirst(), * end = rule.unitySources.getEnd(); j < end; ++j)
+      unitySources.append(*j);
+  }
+  if(unityFiles.isEmpty())
+    return;
+  engine.addDefaultKey("__unityFiles", join(unityFiles));
+  engine.addDefaultKey("__unitySources", join(unitySources));
+}
+
+bool Mare::writeUnityFile(const String& file, const String* sources, size_t count)
+{
+  String dir = File::getDirname(file);
+  String currentDir = Directory::getCurrent() + "/";
+  String text("/* generated by mare */\n");
+  for(const String* i = sources, * end = sources + count; i < end; ++i)
+  {
+    // include the source file relative to the directory of the unity file
+    String path;
+    if(File::isPathAbsolute(*i) || dir == ".")
+      path = *i;
+    else
+    {
+      path = File::relativePath(File::isPathAbsolute(dir) ? dir : currentDir + dir, currentDir + *i);
+      if(path.isEmpty())
+        path = currentDir + *i;
+    }
+    text.append("#include \"");
+    text.append(path);
+    text.append("\"\n");
+  }
+
+  // keep the file (and its modification time) if its content has not changed
+  {
+    File oldFile;
+    if(oldFile.open(file))
+    {
+      String oldText;
+      char buffer[4096];
+      size_t i;
+      while((i = oldFile.read(buffer, sizeof(buffer))) > 0)
+        oldText.append(buffer, i);
+      if(oldText == text)
+      {
+        engine.addInputFile(file);
+        return true;
+      }
+    }
+  }
+  File newFile;
+  if(!Directory::create(dir) || !newFile.open(file, File::writeFlag) || !newFile.write(text))
+    return false;
+  newFile.close();
+  engine.addInputFile(file);
+  return true;
+}
+
+bool Mare::enterTarget(const String& platform, const String& configuration, const String& name, const Target* target)
+{
+  engine.enterUnnamedKey();
+  engine.addDefaultKey("platform", platform);
+  engine.addDefaultKey(platform, platform);
+  engine.addDefaultKey("configuration", configuration);
+  engine.addDefaultKey(configuration, configuration);
+  engine.addDefaultKey("target", name);
+  //engine.addDefaultKey(name, name);
+  if(target)
+    addUnityKeys(*target);
+  engine.enterRootKey();
+  VERIFY(engine.enterKey("targets"));
+  if(!engine.enterKey(name))
+  {
+    engine.error(String().format(256, "cannot find target \"%s\"", name.getData()));
+    return false;
+  }
+  engine.addDefaultKey("mareDir", engine.getMareDir());
+  return true;
+}
+
+void Mare::leaveTarget()
+{
+  engine.leaveKey();
+  engine.leaveKey();
+  engine.leaveKey();
+  engine.leaveKey();
+}
+
+void Mare::addVariantKeys(const String& platform, const String& configuration)
+{
+  // results that do not depend on any of these keys are shared between the configurations
+  engine.addVariantKey("platform");
+  engine.addVariantKey(platform);
+  engine.addVariantKey("configuration");
+  engine.addVariantKey(configuration);
+}
+
+String Mare::getCacheKey(const Map<String, String>& userArgs) const
+{
+  String key("mare-cache 8\n");
+  key.append("file ");
+  key.append(inputFile);
+  for(const List<String>::Node* i = inputPlatforms.getFirst(); i; i = i->getNext())
+  {
+    key.append("\nplatform ");
+    key.append(i->data);
+  }
+  for(const List<String>::Node* i = inputConfigs.getFirst(); i; i = i->getNext())
+  {
+    key.append("\nconfig ");
+    key.append(i->data);
+  }
+  for(const List<String>::Node* i = inputTargets.getFirst(); i; i = i->getNext())
+  {
+    key.append("\ntarget ");
+    key.append(i->data);
+  }
+  for(const Map<String, String>::Node* i = userArgs.getFirst(); i; i = i->getNext())
+  {
+    key.append("\narg ");
+    key.append(i->key);
+    key.append('=');
+    key.append(i->data);
+  }
+  return key;
+}
+
+class CacheWriter
+{
+public:
+  String data;
+
+  void writeNumber(long long number)
+  {
+    char buffer[32];
+    int len = sprintf(buffer, "%lld\n", number);
+    data.append(buffer, len);
+  }
+
+  void writeString(const String& string)
+  {
+    char buffer[32];
+    int len = sprintf(buffer, "%u:", (unsigned int)string.getLength());
+    data.append(buffer, len);
+    data.append(string);
+    data.append('\n');
+  }
+
+  void writeList(const Array<String>& list, size_t omittedLast = 0)
+  {
+    writeNumber(list.getSize() - omittedLast);
+    for(const String* i = list.getFirst(), * end = list.getEnd() - omittedLast; i < end; ++i)
+      writeString(*i);
+  }
+};
+
+class CacheReader
+{
+public:
+  const char* pos;
+  const char* end;
+
+  bool readNumber(long long& number)
+  {
+    char* numberEnd;
+    number = strtoll(pos, &numberEnd, 10);
+    if(numberEnd == pos || numberEnd >= end || *numberEnd != '\n')
+      return false;
+    pos = numberEnd + 1;
+    return true;
+  }
+
+  bool readString(String& string)
+  {
+    char* lengthEnd;
+    unsigned long length = strtoul(pos, &lengthEnd, 10);
+    if(lengthEnd == pos || lengthEnd >= end || *lengthEnd != ':' || (unsigned long)(end - lengthEnd) < length + 2 || lengthEnd[1 + length] != '\n')
+      return false;
+    string = String(lengthEnd + 1, length);
+    pos = lengthEnd + 2 + length;
+    return true;
+  }
+
+  bool readList(Array<String>& list)
+  {
+    long long size;
+    if(!readNumber(size) || size > (end - pos) / 3) // each string takes at least 3 bytes
+      return false;
+    if(size > 0)
+      list.setCapacity(list.getSize() + (size_t)size);
+    for(; size > 0; --size)
+      if(!readString(list.append()))
+        return false;
+    return true;
+  }
+};
+
+bool Mare::loadCache(const String& cacheFile, const String& cacheKey, List<RuleSet>& ruleSets)
+{
+  String data;
+  {
+    File file;
+    if(!file.open(cacheFile))
+      return false;
+    char buffer[65536];
+    size_t i;
+    while((i = file.read(buffer, sizeof(buffer))) > 0)
+      data.append(buffer, i);
+  }
+  CacheReader reader;
+  reader.pos = data.getData();
+  reader.end = reader.pos + data.getLength();
+
+  // check whether the cache was created with the same command line and the same mare executable
+  String string;
+  if(!reader.readString(string))
+    return false;
+  if(string != cacheKey)
+  {
+    if(showDebug)
+      printf("debug: Evaluating the Marefile since the cached rules were created by another mare executable\n");
+    return false;
+  }
+
+  // check whether the Marefile and all files, directories and environment variables that were used during its evaluation are unchanged
+  long long count;
+  if(!reader.readNumber(count))
+    return false;
+  for(long long cachedWriteTime, writeTime; count > 0; --count)
+  {
+    if(!reader.readString(string) || !reader.readNumber(cachedWriteTime))
+      return false;
+    if(!File::getWriteTime(string, writeTime))
+      writeTime = -1;
+    if(writeTime != cachedWriteTime)
+    {
+      if(showDebug)
+        printf("debug: Evaluating the Marefile since \"%s\" has changed\n", string.getData());
+      return false;
+    }
+  }
+  if(!reader.readNumber(count))
+    return false;
+  const Map<String, String>& envs = Process::getEnvironmentVariables();
+  for(String value; count > 0; --count)
+  {
+    if(!reader.readString(string) || !reader.readString(value))
+      return false;
+    const Map<String, String>::Node* envNode = envs.find(string);
+    if(envNode ? envNode->data != value : !value.isEmpty())
+    {
+      if(showDebug)
+        printf("debug: Evaluating the Marefile since the environment variable \"%s\" has changed\n", string.getData());
+      return false;
+    }
+  }
+
+  // load rules (into a separate list, since a truncated cache file leaves incomplete rule sets)
+  List<RuleSet> cachedRuleSets;
+  if(!reader.readNumber(count))
+    return false;
+  for(; count > 0; --count)
+  {
+    RuleSet& ruleSet = cachedRuleSets.append();
+    long long targetCount;
+    if(!reader.readString(ruleSet.platform) || !reader.readString(ruleSet.configuration) || !reader.readNumber(targetCount))
+      return false;
+    for(; targetCount > 0; --targetCount)
+    {
+      long long active, ruleCount;
+      if(!reader.readString(string) || !reader.readNumber(active) || !reader.readNumber(ruleCount) || ruleCount <= 0)
+        return false;
+      Target& target = ruleSet.targets.append(string);
+      target.ruleSet = &ruleSet;
+      if(active)
+      {
+        target.active = true;
+        ruleSet.activeTargets.append(&target);
+      }
+      for(; ruleCount > 0; --ruleCount)
+      {
+        Rule& rule = target.rules.append();
+        rule.builder = this;
+        rule.target = &target;
+        long long evaluated;
+        if(!reader.readString(rule.name) || !reader.readList(rule.dependencies) || !reader.readList(rule.inputs) ||
+           !reader.readList(rule.outputs) || !reader.readNumber(evaluated) || !reader.readList(rule.command) || !reader.readList(rule.message) ||
+           !reader.readString(rule.batchCommand) || !reader.readString(rule.batchDir) || !reader.readList(rule.batchOutputs) || !reader.readList(rule.unitySources) ||
+           !reader.readString(rule.precompiledHeaderRule) || !reader.readString(rule.moduleScanFile) || !reader.readString(rule.moduleScanCommand) ||
+           !reader.readString(rule.moduleMapper))
+          return false;
+        rule.evaluated = evaluated != 0;
+      }
+      target.rule = &target.rules.getLast()->data;
+    }
+  }
+  if(!reader.readString(string) || string != "end")
+    return false;
+  ruleSets.swap(cachedRuleSets);
+
+  if(showDebug)
+    printf("debug: Using the cached rules from \"%s\"\n", cacheFile.getData());
+  return true;
+}
+
+void Mare::saveCache(const String& cacheFile, const String& cacheKey, const List<RuleSet>& ruleSets)
+{
+  CacheWriter writer;
+  writer.writeString(cacheKey);
+
+  const Map<String, long long>& inputFiles = engine.getInputFiles();
+  writer.writeNumber(inputFiles.getSize());
+  for(const Map<String, long long>::Node* i = inputFiles.getFirst(); i; i = i->getNext())
+  {
+    writer.writeString(i->key);
+    writer.writeNumber(i->data);
+  }
+  const Map<String, String>& inputEnvironmentVariables = engine.getInputEnvironmentVariables();
+  writer.writeNumber(inputEnvironmentVariables.getSize());
+  for(const Map<String, String>::Node* i = inputEnvironmentVariables.getFirst(); i; i = i->getNext())
+  {
+    writer.writeString(i->key);
+    writer.writeString(i->data);
+  }
+
+  writer.writeNumber(ruleSets.getSize());
+  for(const List<RuleSet>::Node* i = ruleSets.getFirst(); i; i = i->getNext())
+  {
+    const RuleSet& ruleSet = i->data;
+    writer.writeString(ruleSet.platform);
+    writer.writeString(ruleSet.configuration);
+    writer.writeNumber(ruleSet.targets.getSize());
+    for(const Map<String, Target>::Node* i = ruleSet.targets.getFirst(); i; i = i->getNext())
+    {
+      const Target& target = i->data;
+      writer.writeString(i->key);
+      writer.writeNumber(target.active ? 1 : 0);
+      writer.writeNumber(target.rules.getSize());
+      for(const List<Rule>::Node* i = target.rules.getFirst(); i; i = i->getNext())
+      {
+        const Rule& rule = i->data;
+        writer.writeString(rule.name);
+        writer.writeList(rule.dependencies);
+        writer.writeList(rule.inputs, rule.dependencyInputs); // the outputs of dependencies are appended again when the rules are loaded
+        writer.writeList(rule.outputs);
+        writer.writeNumber(rule.evaluated ? 1 : 0);
+        writer.writeList(rule.command);
+        writer.writeList(rule.message);
+        writer.writeString(rule.batchCommand);
+        writer.writeString(rule.batchDir);
+        writer.writeList(rule.batchOutputs);
+        writer.writeList(rule.unitySources);
+        writer.writeString(rule.precompiledHeaderRule);
+        writer.writeString(rule.moduleScanFile);
+        writer.writeString(rule.moduleScanCommand);
+        writer.writeString(rule.moduleMapper);
+      }
+    }
+  }
+  writer.writeString("end");
+
+  // the cache file is replaced at once, so that an interrupted or a concurrent run never leaves a truncated cache file
+  String tmpFile;
+  tmpFile.format(cacheFile.getLength() + 32, "%s.%u.tmp", cacheFile.getData(), Process::getCurrentProcessId());
+  bool written;
+  {
+    File file;
+    written = Directory::create(File::getDirname(cacheFile)) && file.open(tmpFile, File::writeFlag) && file.write(writer.data);
+  }
+  if(!written || !File::rename(tmpFile, cacheFile))
+  {
+    if(showDebug)
+      printf("debug: Cannot write cache file \"%s\": %s\n", cacheFile.getData(), Error::getString().getData());
+    File::unlink(tmpFile);
+  }
 }
 
 String Mare::join(const List<String>& words)
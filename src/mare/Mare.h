@@ -3,17 +3,20 @@
 
 #include "Tools/List.h"
 #include "Tools/Map.h"
+#include "Tools/String.h"
 
 class Engine;
 class Word;
-class String;
+class RuleSet;
+class Rule;
+class Target;
 
 class Mare
 {
 public:
 
-  Mare(Engine& engine, List<String>& inputPlatforms, List<String>& inputConfigs, List<String>& inputTargets, bool showDebug, bool clean, bool rebuild, int jobs, bool ignoreDependencies) :
-    engine(engine), showDebug(showDebug), clean(clean), rebuild(rebuild), jobs(jobs), ignoreDependencies(ignoreDependencies), inputPlatforms(inputPlatforms), inputConfigs(inputConfigs), inputTargets(inputTargets) {}
+  Mare(Engine& engine, const String& inputFile, List<String>& inputPlatforms, List<String>& inputConfigs, List<String>& inputTargets, bool showDebug, bool clean, bool rebuild, int jobs, bool ignoreDependencies) :
+    engine(engine), inputFile(inputFile), loaded(false), userArgs(0), showDebug(showDebug), clean(clean), rebuild(rebuild), jobs(jobs), ignoreDependencies(ignoreDependencies), evaluatedTarget(0), evaluatedFiles(false), inputPlatforms(inputPlatforms), inputConfigs(inputConfigs), inputTargets(inputTargets) {}
 
   bool build(const Map<String, String>& userArgs);
 
@@ -21,19 +24,39 @@ public:
 
 private:
   Engine& engine;
+  String inputFile;
+  bool loaded;
+  const Map<String, String>* userArgs;
   bool showDebug;
   bool clean;
   bool rebuild;
   int jobs;
   bool ignoreDependencies;
+  Target* evaluatedTarget; /**< The target entered by evaluateCommands() (it stays entered for evaluating the next rule) */
+  bool evaluatedFiles; /**< Whether evaluateCommands() has entered the "files" key of \c evaluatedTarget */
 
   List<String>& inputPlatforms;
   List<String>& inputConfigs;
   List<String>& inputTargets;
   List<String> allTargets;
 
-  bool buildFile();
-  bool buildTargets(const String& platform, const String& configuration);
+  bool loadFile();
+  void addDefaultKeys(const Map<String, String>& userArgs);
+  bool buildFile(List<RuleSet>& ruleSets);
+  bool buildTargets(const String& platform, const String& configuration, RuleSet& ruleSet);
+  bool buildTarget(const String& platform, const String& configuration, const String& name, RuleSet& ruleSet);
+  bool enterTarget(const String& platform, const String& configuration, const String& name, const Target* target = 0);
+  void leaveTarget();
+  Rule& addFileRule(Target& target, const String& name);
+  void addUnityKeys(const Target& target);
+  bool writeUnityFile(const String& file, const String* sources, size_t count);
+  void addVariantKeys(const String& platform, const String& configuration);
+  bool evaluateCommands(Rule& rule);
+  void leaveEvaluatedTarget();
+
+  String getCacheKey(const Map<String, String>& userArgs) const;
+  bool loadCache(const String& cacheFile, const String& cacheKey, List<RuleSet>& ruleSets);
+  void saveCache(const String& cacheFile, const String& cacheKey, const List<RuleSet>& ruleSets);
 
   friend class Rule;
 };
@@ -0,0 +1,161 @@
+
+#include <cstring>
+
+#include "Tools/File.h"
+
+#include "ModuleDependencies.h"
+
+class P1689Parser
+{
+public:
+  const char* pos;
+  ModuleDependencies& result;
+
+  P1689Parser(const char* pos, ModuleDependencies& result) : pos(pos), result(result) {}
+
+  /**
+  * Parses a JSON value and collects the "logical-name" strings of the objects in "provides" and "requires" arrays
+  * @param list The list for the logical names found in the value or \c 0
+  */
+  bool parseValue(Array<String>* list)
+  {
+    skipSpace();
+    switch(*pos)
+    {
+    case '{':
+      ++pos;
+      skipSpace();
+      if(*pos == '}')
+        break;
+      for(;;)
+      {
+        String key;
+        skipSpace();
+        if(!parseString(key))
+          return false;
+        skipSpace();
+        if(*pos != ':')
+          return false;
+        ++pos;
+        skipSpace();
+        if(*pos == '"' && list && key == "logical-name")
+        {
+          if(!parseString(list->append()))
+            return false;
+        }
+        else if(!parseValue(key == "provides" ? &result.providedModules : key == "requires" ? &result.requiredModules : 0))
+          return false;
+        skipSpace();
+        if(*pos == '}')
+          break;
+        if(*pos != ',')
+          return false;
+        ++pos;
+      }
+      break;
+    case '[':
+      ++pos;
+      skipSpace();
+      if(*pos == ']')
+        break;
+      for(;;)
+      {
+        if(!parseValue(list))
+          return false;
+        skipSpace();
+        if(*pos == ']')
+          break;
+        if(*pos != ',')
+          return false;
+        ++pos;
+      }
+      break;
+    case '"':
+      {
+        String string;
+        return parseString(string);
+      }
+    default: // numbers, true, false and null
+      if(!*pos || !strchr("-0123456789tfn", *pos))
+        return false;
+      while(*pos && !strchr(",]} \t\r\n", *pos))
+        ++pos;
+      return true;
+    }
+    ++pos;
+    return true;
+  }
+
+private:
+  void skipSpace()
+  {
+    while(*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n')
+      ++pos;
+  }
+
+  bool parseString(String& string)
+  {
+    if(*pos != '"')
+      return false;
+    ++pos;
+    for(;;)
+    {
+      const char* start = pos;
+      while(*pos && *pos != '"' && *pos != '\\')
+        ++pos;
+      string.append(start, pos - start);
+      if(*pos == '"')
+      {
+        ++pos;
+        return true;
+      }
+      if(!*pos || !pos[1])
+        return false;
+      ++pos;
+      switch(*pos)
+      {
+      case 'b': string.append('\b'); break;
+      case 'f': string.append('\f'); break;
+      case 'n': string.append('\n'); break;
+      case 'r': string.append('\r'); break;
+      case 't': string.append('\t'); break;
+      case 'u': // module names and file names are expected to be ASCII
+        {
+          unsigned int c = 0;
+          for(int i = 0; i < 4; ++i)
+          {
+            char h = *(++pos);
+            if(h >= '0' && h <= '9') c = c * 16 + (h - '0');
+            else if(h >= 'a' && h <= 'f') c = c * 16 + (h - 'a' + 10);
+            else if(h >= 'A' && h <= 'F') c = c * 16 + (h - 'A' + 10);
+            else return false;
+          }
+          string.append((char)(c < 0x80 ? c : '?'));
+        }
+        break;
+      default: string.append(*pos); break;
+      }
+      ++pos;
+    }
+  }
+};
+
+bool ModuleDependencies::read(const String& file)
+{
+  providedModules.clear();
+  requiredModules.clear();
+
+  String data;
+  {
+    File f;
+    if(!f.open(file))
+      return false;
+    char buffer[4096];
+    size_t i;
+    while((i = f.read(buffer, sizeof(buffer))) > 0)
+      data.append(buffer, i);
+  }
+
+  P1689Parser parser(data.getData(), *this);
+  return parser.parseValue(0);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Tools/Array.h"
+#include "Tools/String.h"
+
+/**
+* The C++ modules provided and required by a source file as reported by a compiler in the P1689 format
+* (e.g. with "g++ -fdeps-format=p1689r5 -fdeps-file=<file>")
+*/
+class ModuleDependencies
+{
+public:
+  Array<String> providedModules; /**< The logical names of the modules provided by the source file */
+  Array<String> requiredModules; /**< The logical names of the modules imported by the source file */
+
+  /**
+  * Reads a P1689 dependency file
+  * @param file The file
+  * @return Whether the file could be read and parsed
+  */
+  bool read(const String& file);
+};
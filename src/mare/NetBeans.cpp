@@ -10,6 +10,7 @@
 //#include "Tools/Word.h"
 #include "Tools/Directory.h"
 
+#include "Builtin.h"
 #include "NetBeans.h"
 
 bool NetBeans::generate(const Map<String, String>& userArgs)
@@ -121,6 +122,9 @@ bool NetBeans::readFile()
         engine.getText("buildCommand", projectConfig.buildCommand, false);
         engine.getText("reBuildCommand", projectConfig.reBuildCommand, false);
         engine.getText("cleanCommand", projectConfig.cleanCommand, false);
+        Builtin::getShellCommands(projectConfig.buildCommand);
+        Builtin::getShellCommands(projectConfig.reBuildCommand);
+        Builtin::getShellCommands(projectConfig.cleanCommand);
         projectConfig.buildDir = engine.getFirstKey("buildDir", true);
         projectConfig.firstOutput = engine.getFirstKey("output", false);
         engine.getKeys("defines", projectConfig.defines, true);